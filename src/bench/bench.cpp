@@ -0,0 +1,544 @@
+/**
+ * gtproxy_bench: microbenchmarks of the packet-processing primitives.
+ *
+ * Covers what every relayed packet goes through: ByteStream reads and writes,
+ * TextParse and TextParseView, the delimiter scanner against the old
+ * std::views::split tokenizer, Variant (de)serialization and VariantView, the
+ * event and packet dispatchers with realistic listener counts, the ENet CRC32
+ * and the range coder. Results are written as JSON (stdout unless --out is given) so runs can
+ * be compared across releases; a readable summary goes to stderr.
+ *
+ * Usage: gtproxy_bench [--filter SUBSTRING] [--min-time SECONDS] [--out FILE]
+ */
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <ranges>
+#include <thread>
+#include <enet/enet.h>
+#include <fmt/chrono.h>
+#include <magic_enum/magic_enum.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "bench.hpp"
+#include "../core/core.hpp"
+#include "../packet/packet_types.hpp"
+#include "../packet/packet_variant.hpp"
+#include "../packet/variant_view.hpp"
+#include "../utils/byte_stream.hpp"
+#include "../utils/delimiter_scanner.hpp"
+#include "../utils/text_parse.hpp"
+#include "../utils/text_parse_view.hpp"
+
+namespace {
+// What the game sends on login, with the hashes and tokens replaced.
+const std::string login_message{
+    "tankIDName|\n"
+    "tankIDPass|\n"
+    "requestedName|BraveDuck\n"
+    "f|1\n"
+    "protocol|209\n"
+    "game_version|4.61\n"
+    "fz|47142936\n"
+    "lmode|1\n"
+    "cbits|1040\n"
+    "player_age|20\n"
+    "GDPR|3\n"
+    "category|_-5100\n"
+    "totalPlaytime|0\n"
+    "klv|7f0a6c3b9a2d4e5f6a7b8c9d0e1f2a3b4c5d6e7f8a9b0c1d2e3f4a5b6c7d8e9f\n"
+    "hash2|1288423511\n"
+    "meta|localhost\n"
+    "fhash|-716928004\n"
+    "rid|0123456789ABCDEF0123456789ABCDEF\n"
+    "platformID|0,1,1\n"
+    "deviceVersion|0\n"
+    "country|us\n"
+    "hash|-1451730151\n"
+    "mac|02:00:00:00:00:00\n"
+    "wk|NONE0\n"
+    "zf|-1331849031\n"
+};
+
+const std::string spawn_message{
+    "spawn|avatar\n"
+    "netID|7\n"
+    "userID|123456\n"
+    "colrect|0|0|20|30\n"
+    "posXY|1440|736\n"
+    "name|``BraveDuck``\n"
+    "country|us\n"
+    "invis|0\n"
+    "mstate|0\n"
+    "smstate|0\n"
+    "onlineID|\n"
+    "type|local\n"
+};
+
+// A long OnDialogRequest, the largest text the proxy routinely splits.
+std::string make_dialog(const std::size_t size)
+{
+    std::string dialog{ "set_default_color|`o\nadd_label_with_icon|big|`wWorld Lock``|left|242|\n" };
+    for (int i{ 0 }; dialog.size() < size; i++) {
+        dialog += fmt::format(
+            "add_button_with_icon|item_{}|`2Item {}``|staticBlueFrame|{}|{}|\nadd_textbox|Some description of item {}.|left|\n",
+            i,
+            i,
+            242 + i,
+            i % 200,
+            i
+        );
+    }
+
+    return dialog + "end_dialog|store|Close|Buy|\n";
+}
+
+// TextParse::tokenize as it was before the delimiter scanner, to compare against.
+std::vector<std::string> tokenize_split(const std::string& string, const std::string& delimiter)
+{
+    std::vector<std::string> tokens{};
+    for (auto&& token : string | std::views::split(delimiter)) {
+        if (token.empty()) {
+            continue;
+        }
+
+        tokens.emplace_back(token.begin(), token.end());
+    }
+
+    return tokens;
+}
+
+packet::Variant make_variant()
+{
+    return packet::Variant{
+        std::string{ "OnSpawn" },
+        spawn_message,
+        glm::vec2{ 1440.0f, 736.0f },
+        uint32_t{ 88 },
+        int32_t{ -1 }
+    };
+}
+
+// A game packet as it arrives: message type, header, extended data.
+std::vector<std::byte> make_game_packet(const std::size_t ext_size)
+{
+    packet::GameUpdatePacket header{};
+    header.type = packet::PACKET_CALL_FUNCTION;
+    header.net_id = 7;
+    header.flags.extended = 1;
+    header.data_size = static_cast<uint32_t>(ext_size);
+
+    ByteStream byte_stream{};
+    byte_stream.write(packet::NET_MESSAGE_GAME_PACKET);
+    byte_stream.write(header);
+    byte_stream.write_vector(std::vector<std::byte>(ext_size, std::byte{ 0x5a }), false);
+    return byte_stream.get_data();
+}
+
+// A run of state updates, which compress about as well as real traffic.
+std::vector<std::byte> make_state_stream(const std::size_t size)
+{
+    std::vector<std::byte> data{};
+    for (uint32_t i{ 0 }; data.size() < size; i++) {
+        packet::GameUpdatePacket state{};
+        state.type = packet::PACKET_STATE;
+        state.net_id = 7;
+        state.vec_x = 1440.0f + static_cast<float>(i % 32);
+        state.vec_y = 736.0f;
+        state.int_x = -1;
+        state.int_y = -1;
+
+        const auto* bytes{ reinterpret_cast<const std::byte*>(&state) };
+        data.insert(data.end(), bytes, bytes + sizeof(state));
+    }
+
+    data.resize(size);
+    return data;
+}
+
+void bench_byte_stream(bench::Runner& runner)
+{
+    const std::vector data{ make_game_packet(256) };
+    const std::vector<std::byte> ext_data(256, std::byte{ 0x5a });
+
+    runner.run("ByteStream/write", data.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            packet::GameUpdatePacket header{};
+            header.type = packet::PACKET_CALL_FUNCTION;
+            header.data_size = static_cast<uint32_t>(ext_data.size());
+
+            ByteStream byte_stream{};
+            byte_stream.write(packet::NET_MESSAGE_GAME_PACKET);
+            byte_stream.write(header);
+            byte_stream.write_vector(ext_data, false);
+            bench::do_not_optimize(byte_stream.get_data());
+        }
+    });
+
+    runner.run("ByteStream/read", data.size(), [&](const uint64_t iterations) {
+        ByteStream byte_stream{ const_cast<std::byte*>(data.data()), data.size() };
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            byte_stream.reset_ptr();
+
+            packet::NetMessageType type{};
+            packet::GameUpdatePacket header{};
+            std::vector<std::byte> ext{};
+            byte_stream.read(type);
+            byte_stream.read(header);
+            byte_stream.read_vector(ext, static_cast<uint16_t>(header.data_size));
+            bench::do_not_optimize(ext);
+        }
+    });
+
+    runner.run("ByteStreamView/read", data.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            ByteStreamView byte_stream{ std::span{ data } };
+
+            packet::NetMessageType type{};
+            packet::GameUpdatePacket header{};
+            std::span<const std::byte> ext{};
+            byte_stream.read(type);
+            byte_stream.read(header);
+            byte_stream.read_span(ext, header.data_size);
+            bench::do_not_optimize(ext);
+        }
+    });
+}
+
+void bench_text_parse(bench::Runner& runner)
+{
+    runner.run("TextParse/parse", login_message.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            TextParse text_parse{ login_message };
+            bench::do_not_optimize(text_parse);
+        }
+    });
+
+    TextParseView view{};
+    runner.run("TextParseView/parse", login_message.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            view.parse(login_message);
+            bench::do_not_optimize(view);
+        }
+    });
+
+    runner.run("TextParseView/get", 0, [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            const std::string_view value{ view.get("requestedName") };
+            bench::do_not_optimize(value);
+        }
+    });
+
+    const TextParse text_parse{ login_message };
+    runner.run("TextParse/get", 0, [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            std::string value{ text_parse.get("requestedName") };
+            bench::do_not_optimize(value);
+        }
+    });
+
+    runner.run("TextParse/get_raw", login_message.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            std::string raw{ text_parse.get_raw() };
+            bench::do_not_optimize(raw);
+        }
+    });
+}
+
+// Every supported instruction set must find exactly what the scalar loop finds.
+bool check_delimiter_scanner(const std::string& dialog)
+{
+    std::vector<std::string> inputs{ dialog };
+
+    // Short and odd lengths exercise the tails after the last full vector.
+    std::mt19937 random{ 1 };
+    constexpr std::string_view alphabet{ "ab|\n\0\xff", 6 };
+    for (std::size_t length{ 0 }; length < 300; length++) {
+        std::string& input{ inputs.emplace_back(length, ' ') };
+        for (char& c : input) {
+            c = alphabet[random() % alphabet.size()];
+        }
+    }
+
+    for (const auto isa : { DelimiterScanner::Isa::Sse2, DelimiterScanner::Isa::Avx2 }) {
+        if (!DelimiterScanner::is_supported(isa)) {
+            continue;
+        }
+
+        for (const std::string& input : inputs) {
+            std::vector<uint32_t> expected{};
+            std::vector<uint32_t> positions{};
+            DelimiterScanner::scan(DelimiterScanner::Isa::Scalar, input, '\n', '|', expected);
+            DelimiterScanner::scan(isa, input, '\n', '|', positions);
+
+            if (positions != expected) {
+                spdlog::error(
+                    "DelimiterScanner/{} disagrees with Scalar on a {} byte input",
+                    magic_enum::enum_name(isa),
+                    input.size()
+                );
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool bench_delimiter_scanner(bench::Runner& runner)
+{
+    const std::string dialog{ make_dialog(4096) };
+    if (!check_delimiter_scanner(dialog)) {
+        return false;
+    }
+
+
+    runner.run("tokenize/views_split", dialog.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            std::vector tokens{ tokenize_split(dialog, "|") };
+            bench::do_not_optimize(tokens);
+        }
+    });
+
+    runner.run("tokenize/scanner", dialog.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            std::vector tokens{ TextParse::tokenize(dialog, "|") };
+            bench::do_not_optimize(tokens);
+        }
+    });
+
+    TextParseView view{};
+    runner.run("TextParseView/parse_dialog", dialog.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            view.parse(dialog);
+            bench::do_not_optimize(view);
+        }
+    });
+
+    std::vector<uint32_t> positions{};
+    for (const auto isa : { DelimiterScanner::Isa::Scalar, DelimiterScanner::Isa::Sse2, DelimiterScanner::Isa::Avx2 }) {
+        if (!DelimiterScanner::is_supported(isa)) {
+            continue;
+        }
+
+        runner.run(fmt::format("DelimiterScanner/{}", magic_enum::enum_name(isa)), dialog.size(), [&](const uint64_t iterations) {
+            for (uint64_t i{ 0 }; i < iterations; i++) {
+                positions.clear();
+                DelimiterScanner::scan(isa, dialog, '\n', '|', positions);
+                bench::do_not_optimize(positions);
+            }
+        });
+    }
+
+    return true;
+}
+
+void bench_variant(bench::Runner& runner)
+{
+    const packet::Variant variant{ make_variant() };
+    const std::vector data{ variant.serialize() };
+
+    runner.run("Variant/serialize", data.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            std::vector serialized{ variant.serialize() };
+            bench::do_not_optimize(serialized);
+        }
+    });
+
+    runner.run("Variant/deserialize", data.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            packet::Variant deserialized{};
+            static_cast<void>(deserialized.deserialize(data));
+            bench::do_not_optimize(deserialized);
+        }
+    });
+
+    // What the parser extension does per call function, then reading one argument.
+    runner.run("VariantView/function_name", data.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            const packet::VariantView view{ data };
+            std::string_view function_name{ view.get(0) };
+            bench::do_not_optimize(function_name);
+        }
+    });
+
+    runner.run("VariantView/get", data.size(), [&](const uint64_t iterations) {
+        for (uint64_t i{ 0 }; i < iterations; i++) {
+            const packet::VariantView view{ data };
+            std::string_view function_name{ view.get(0) };
+            glm::vec2 position{ view.get<glm::vec2>(2) };
+            bench::do_not_optimize(function_name);
+            bench::do_not_optimize(position);
+        }
+    });
+}
+
+void bench_dispatch(bench::Runner& runner)
+{
+    const player::Player player{};
+    const std::string text{ "action|input\ntext|hello\n" };
+    const TextParseView message{ text };
+
+    std::vector data{ make_game_packet(0) };
+    packet::GameUpdatePacket header{};
+    header.type = packet::PACKET_STATE;
+
+    // One listener is a bare parser; sixteen is every bundled extension and then some.
+    for (const int listeners : { 1, 4, 16 }) {
+        uint64_t calls{ 0 };
+
+        core::EventDispatcher event_dispatcher{};
+        core::PacketDispatcher packet_dispatcher{};
+        for (int i{ 0 }; i < listeners; i++) {
+            event_dispatcher.appendListener(core::EventType::Message, [&calls](const core::EventMessage&) { calls++; });
+            packet_dispatcher.append_listener(
+                packet::PACKET_STATE,
+                core::EventFrom::FromClient,
+                [&calls](const core::EventPacket&) { calls++; }
+            );
+        }
+
+        runner.run(fmt::format("EventDispatcher/message/{}", listeners), 0, [&](const uint64_t iterations) {
+            for (uint64_t i{ 0 }; i < iterations; i++) {
+                const core::EventMessage event{ nullptr, player, player, message };
+                event.from = core::EventFrom::FromClient;
+                event_dispatcher.dispatch(event);
+            }
+
+            bench::do_not_optimize(calls);
+        });
+
+        runner.run(fmt::format("PacketDispatcher/state/{}", listeners), 0, [&](const uint64_t iterations) {
+            for (uint64_t i{ 0 }; i < iterations; i++) {
+                const core::EventPacket event{ nullptr, player, player, header, data };
+                event.from = core::EventFrom::FromClient;
+                packet_dispatcher.dispatch(event);
+            }
+
+            bench::do_not_optimize(calls);
+        });
+    }
+}
+
+void bench_enet(bench::Runner& runner)
+{
+    // A full datagram and a single state update.
+    for (const std::size_t size : { std::size_t{ 1400 }, sizeof(packet::GameUpdatePacket) + 4 }) {
+        std::vector data{ make_state_stream(size) };
+
+        ENetBuffer buffer{};
+        buffer.data = data.data();
+        buffer.dataLength = data.size();
+
+        runner.run(fmt::format("enet_crc32/{}", size), size, [&](const uint64_t iterations) {
+            for (uint64_t i{ 0 }; i < iterations; i++) {
+                const enet_uint32 crc{ enet_crc32(&buffer, 1) };
+                bench::do_not_optimize(crc);
+            }
+        });
+
+        void* range_coder{ enet_range_coder_create() };
+        std::vector<enet_uint8> compressed(size * 2);
+        const std::size_t compressed_size{
+            enet_range_coder_compress(range_coder, &buffer, 1, size, compressed.data(), compressed.size())
+        };
+
+        runner.run(fmt::format("range_coder/compress/{}", size), size, [&](const uint64_t iterations) {
+            for (uint64_t i{ 0 }; i < iterations; i++) {
+                const std::size_t written{
+                    enet_range_coder_compress(range_coder, &buffer, 1, size, compressed.data(), compressed.size())
+                };
+                bench::do_not_optimize(written);
+            }
+        });
+
+        if (compressed_size != 0) {
+            std::vector<enet_uint8> decompressed(size);
+            runner.run(fmt::format("range_coder/decompress/{}", size), size, [&](const uint64_t iterations) {
+                for (uint64_t i{ 0 }; i < iterations; i++) {
+                    const std::size_t written{ enet_range_coder_decompress(
+                        range_coder,
+                        compressed.data(),
+                        compressed_size,
+                        decompressed.data(),
+                        decompressed.size()
+                    ) };
+                    bench::do_not_optimize(written);
+                }
+            });
+        }
+
+        enet_range_coder_destroy(range_coder);
+    }
+}
+}
+
+int main(const int argc, char** argv)
+{
+    spdlog::set_default_logger(spdlog::stderr_color_mt("gtproxy_bench"));
+    spdlog::set_pattern("%v");
+
+    std::string filter{};
+    std::chrono::duration<double> min_time{ 0.5 };
+    std::string out{};
+    for (int i{ 1 }; i < argc; i++) {
+        const std::string_view arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+
+        if (arg == "--filter" && has_value) {
+            filter = argv[++i];
+        }
+        else if (arg == "--min-time" && has_value) {
+            min_time = std::chrono::duration<double>{ std::stod(argv[++i]) };
+        }
+        else if (arg == "--out" && has_value) {
+            out = argv[++i];
+        }
+        else {
+            std::cerr << "Usage: gtproxy_bench [--filter SUBSTRING] [--min-time SECONDS] [--out FILE]\n";
+            return 2;
+        }
+    }
+
+    if (enet_initialize() != 0) {
+        spdlog::error("Failed to initialize ENet");
+        return 1;
+    }
+
+    bench::Runner runner{ filter, min_time };
+    bench_byte_stream(runner);
+    bench_text_parse(runner);
+    if (!bench_delimiter_scanner(runner)) {
+        enet_deinitialize();
+        return 1;
+    }
+
+    bench_variant(runner);
+    bench_dispatch(runner);
+    bench_enet(runner);
+
+    enet_deinitialize();
+
+    const nlohmann::json context{
+        { "date", fmt::format("{:%Y-%m-%dT%H:%M:%S}", std::chrono::system_clock::now()) },
+        { "executable", argv[0] },
+        { "num_cpus", std::thread::hardware_concurrency() },
+        { "gtproxy_version", fmt::format("{}.{}.{}", GTPROXY_VERSION_MAJOR, GTPROXY_VERSION_MINOR, GTPROXY_VERSION_PATCH) },
+#ifdef GTPROXY_DEBUG
+        { "library_build_type", "debug" }
+#else
+        { "library_build_type", "release" }
+#endif
+    };
+
+    const std::string report{ runner.report(context).dump(4) };
+    if (out.empty()) {
+        std::cout << report << std::endl;
+    }
+    else {
+        std::ofstream{ out } << report << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace bench {
+// Keep the compiler from optimizing away a value it can prove is unused.
+template <typename T>
+void do_not_optimize(const T& value)
+{
+#if defined(_MSC_VER)
+    const volatile auto* sink{ reinterpret_cast<const volatile char*>(&value) };
+    static_cast<void>(*sink);
+#else
+    asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+/**
+ * @brief Times benchmarks and collects their results.
+ *
+ * Each benchmark body runs a given number of iterations; the iteration count
+ * grows until one run lasts at least min_time. The report follows Google
+ * Benchmark's JSON layout so its compare tooling works on it.
+ */
+class Runner {
+public:
+    Runner(std::string filter, const std::chrono::duration<double> min_time)
+        : filter_{ std::move(filter) }
+        , min_time_{ min_time }
+    {
+
+    }
+
+    /**
+     * @param bytes_per_iteration Bytes processed per iteration, 0 if throughput does not apply.
+     * @param body Called as body(iterations).
+     */
+    template <typename Body>
+    void run(const std::string& name, const std::size_t bytes_per_iteration, Body&& body)
+    {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+            return;
+        }
+
+        body(1); // warm up
+
+        uint64_t iterations{ 1 };
+        while (true) {
+            const auto cpu_start{ std::clock() };
+            const auto start{ std::chrono::steady_clock::now() };
+            body(iterations);
+            const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - start };
+            const double cpu_elapsed{ static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC };
+
+            if (elapsed >= min_time_ || iterations >= max_iterations) {
+                record(name, iterations, bytes_per_iteration, elapsed.count(), cpu_elapsed);
+                return;
+            }
+
+            // Aim past min_time so the next run is very likely the last.
+            const double scale{ elapsed.count() > 0 ? min_time_.count() / elapsed.count() * 1.4 : 10.0 };
+            iterations = std::min<uint64_t>(max_iterations, std::max<uint64_t>(
+                iterations + 1,
+                static_cast<uint64_t>(static_cast<double>(iterations) * std::min(scale, 10.0))
+            ));
+        }
+    }
+
+    [[nodiscard]] nlohmann::json report(const nlohmann::json& context) const
+    {
+        return { { "context", context }, { "benchmarks", results_ } };
+    }
+
+private:
+    static constexpr uint64_t max_iterations{ 1'000'000'000 };
+
+    void record(
+        const std::string& name,
+        const uint64_t iterations,
+        const std::size_t bytes_per_iteration,
+        const double seconds,
+        const double cpu_seconds
+    )
+    {
+        const auto per_iteration{ [&](const double total) { return total * 1e9 / static_cast<double>(iterations); } };
+
+        nlohmann::json result{
+            { "name", name },
+            { "run_name", name },
+            { "run_type", "iteration" },
+            { "iterations", iterations },
+            { "real_time", per_iteration(seconds) },
+            { "cpu_time", per_iteration(cpu_seconds) },
+            { "time_unit", "ns" }
+        };
+
+        if (bytes_per_iteration != 0) {
+            result["bytes_per_second"] = static_cast<double>(bytes_per_iteration * iterations) / seconds;
+        }
+
+        spdlog::info("{:<40} {:>12.1f} ns {:>14} iterations", name, per_iteration(seconds), iterations);
+        results_.push_back(std::move(result));
+    }
+
+    std::string filter_;
+    std::chrono::duration<double> min_time_;
+    std::vector<nlohmann::json> results_;
+};
+}
@@ -1,20 +1,48 @@
 #include <magic_enum/magic_enum.hpp>
 #include <spdlog/spdlog.h>
-#include <spdlog/fmt/bin_to_hex.h>
+#include <charconv>
 #include <fstream>
 
 #include "client.hpp"
 #include "../packet/packet_helper.hpp"
 #include "../packet/message/core.hpp"
+#include "../core/packet_log.hpp"
 #include "../server/server.hpp"
 #include "../utils/network.hpp"
 
 namespace client {
+namespace {
+// The ticket a game client brings back from a sub-server switch, if its login has one.
+std::optional<core::RedirectTicket> read_ticket(const TextParseView& login)
+{
+    const auto read_int{ [&login](const TextKey key) -> std::optional<int32_t> {
+        const std::string_view text{ login.get(key) };
+        int32_t value{};
+        if (const auto [end, ec]{ std::from_chars(text.data(), text.data() + text.size(), value) };
+            ec != std::errc{} || end != text.data() + text.size()) {
+            return std::nullopt;
+        }
+
+        return value;
+    } };
+
+    const auto token{ read_int("token") };
+    const auto user{ read_int("user") };
+    if (!token || !user) {
+        return std::nullopt;
+    }
+
+    return core::RedirectTicket{ *token, *user, std::string{ login.get("UUIDToken") } };
+}
+}
+
 Client::Client(core::Core* core)
     : core_{ core }
-    , player_{ nullptr }
 {
-    host_ = enet_host_create(nullptr, 1, 2, 0, 0);
+    // One upstream peer per session, all sharing this host's socket.
+    const std::size_t max_sessions{ std::max(core->get_config().get<unsigned int>("core.maxSessions"), 1u) };
+
+    host_ = enet_host_create(nullptr, max_sessions, 2, 0, 0);
     if (!host_) {
         return;
     }
@@ -26,28 +54,23 @@ Client::Client(core::Core* core)
     host_->checksum = enet_crc32;
     host_->usingNewPacket = 1;
 
-    core_->get_event_dispatcher().appendListener(
-        core::EventType::Connection,
-        [&](const core::EventConnection& evt)
-        {
-            if (evt.from != core::EventFrom::FromClient) {
-                return;
-            }
-
-            if (const auto ext{ core_->get_extension(0x153bd697) }; ext) {
-                return;
-            }
-
-            spdlog::warn("The web server extension is not loaded!");
-            spdlog::warn("Trying to using config address and port instead...");
+    if (const core::ConfigSnapshot& config{ core_->get_config().get_snapshot() }; config.capture_enabled) {
+        capture_ = std::make_unique<core::PacketCapture>(
+            config.capture_directory,
+            fmt::format("shard{}-from-server", core_->get_shard()),
+            std::size_t{ config.capture_segment_size } * 1024 * 1024,
+            config.capture_max_segments
+        );
+    }
 
-            const core::Config config{ core_->get_config() };
-            std::ignore = connect(
-                config.get<std::string>("enet.address"),
-                config.get<unsigned int>("enet.port")
-            );
-        }
-    );
+    if (const core::ConfigSnapshot& config{ core_->get_config().get_snapshot() }; config.flight_recorder_enabled) {
+        flight_recorder_ = std::make_unique<core::FlightRecorder>(
+            config.flight_recorder_directory,
+            fmt::format("shard{}-from-server", core_->get_shard()),
+            std::chrono::seconds{ config.flight_recorder_seconds },
+            config.flight_recorder_max_dumps
+        );
+    }
 
     spdlog::info("The client is ready to connect to the server!");
 }
@@ -55,31 +78,94 @@ Client::Client(core::Core* core)
 Client::~Client()
 {
     enet_host_destroy(host_);
-    delete player_;
 }
 
-ENetPeer* Client::connect(const std::string& host, const enet_uint16 port) const
+void Client::connect(core::Session* session, const std::string& host, const enet_uint16 port)
 {
     if (!host_) {
-        return nullptr;
+        return;
+    }
+
+    core::CommandQueue::Command command{ core::CommandQueue::CommandType::Connect };
+    enet_address_set_host(&command.address, host.c_str());
+    command.address.port = port;
+    command.data = session;
+
+    // Held by the upstream leg until its peer disconnects.
+    session->acquire_leg();
+    command_queue_.push(command);
+}
+
+void Client::connect(core::Session* session, const TextParseView& login, const enet_uint32 downstream_host)
+{
+    core::RedirectTable& redirects{ core_->get_redirects() };
+
+    // Set by a sub-server switch, for the game client that brings its ticket back.
+    if (const auto ticket{ read_ticket(login) }; ticket) {
+        if (const auto redirect{ redirects.take(*ticket) }; redirect) {
+            connect(session, redirect->address, redirect->port);
+            return;
+        }
+    }
+
+    // Set by the web server before the game client's first login.
+    if (const auto redirect{ redirects.find(downstream_host) }; redirect) {
+        connect(session, redirect->address, redirect->port);
+        return;
+    }
+
+    // A fixed game server, e.g. the stand-in server when load testing.
+    const core::ConfigSnapshot& config{ core_->get_config().get_snapshot() };
+    if (!config.client_upstream_address.empty()) {
+        connect(session, config.client_upstream_address, static_cast<enet_uint16>(config.client_upstream_port));
+        return;
+    }
+
+    if (const auto ext{ core_->get_extension(0x153bd697) }; ext) {
+        spdlog::error("Session #{} logged in without a redirect from the web server", session->get_id());
+        if (const auto to_player{ session->get_downstream() }; to_player) {
+            to_player->disconnect();
+        }
+
+        return;
     }
 
-    ENetAddress address{};
-    enet_address_set_host(&address, host.c_str());
-    address.port = port;
+    spdlog::warn("The web server extension is not loaded!");
+    spdlog::warn("Trying to using config address and port instead...");
 
-    return enet_host_connect(host_, &address, 2, 0);
+    connect(session, config.enet_address, config.enet_port);
 }
 
-void Client::process()
+void Client::process(const enet_uint32 timeout)
 {
     // Perform client processing here
     if (!host_) {
         return;
     }
 
+    const core::CommandQueue::ServicingScope servicing{ command_queue_ };
+
+    // Run whatever other threads queued for our peers before servicing, so the
+    // sends go out with this service call.
+    const auto on_disconnect_now{ [this](ENetPeer* peer) { on_disconnect(peer); } };
+    const auto on_connect_failed{ [this](void* data) {
+        auto* session{ static_cast<core::Session*>(data) };
+        spdlog::error("No free upstream peer for session #{}", session->get_id());
+
+        if (const auto to_player{ session->get_downstream() }; to_player) {
+            to_player->disconnect_now();
+        }
+
+        core_->get_sessions().release(*session);
+    } };
+    command_queue_.drain(host_, on_disconnect_now, on_connect_failed);
+
+    if (flight_recorder_) {
+        flight_recorder_->service();
+    }
+
     ENetEvent ev{};
-    while (enet_host_service(host_, &ev, 16) > 0) {
+    while (enet_host_service(host_, &ev, timeout) > 0) {
         switch (ev.type) {
         case ENET_EVENT_TYPE_CONNECT:
             on_connect(ev.peer);
@@ -88,11 +174,13 @@ void Client::process()
             on_disconnect(ev.peer);
             break;
         case ENET_EVENT_TYPE_RECEIVE:
-            on_receive(ev.peer, ev.packet);
+            on_receive(ev.peer, ev.packet, ev.channelID);
             break;
         default:
             break;
         }
+
+        command_queue_.drain(host_, on_disconnect_now, on_connect_failed);
     }
 }
 
@@ -104,102 +192,162 @@ void Client::on_connect(ENetPeer* peer)
         peer->address.port
     );
 
-    player_ = new player::Player{ peer };
+    auto* session{ static_cast<core::Session*>(peer->data) };
+    if (!session) {
+        enet_peer_disconnect_now(peer, 0);
+        return;
+    }
+
+    const auto player{ std::make_shared<player::Player>(peer, &command_queue_) };
+    session->attach_upstream(player);
 
-    const core::EventConnection event_connection{ *player_ };
+    // The game client left while we were still connecting on its behalf.
+    if (!session->get_downstream()) {
+        session->detach_upstream();
+        enet_peer_disconnect_now(peer, 0);
+        on_disconnect(peer);
+        return;
+    }
+
+    const core::EventConnection event_connection{ session, *player };
     event_connection.from = core::EventFrom::FromServer;
     core_->get_event_dispatcher().dispatch(event_connection);
 }
 
-void Client::on_receive(ENetPeer* peer, ENetPacket* packet)
+void Client::on_receive(ENetPeer* peer, ENetPacket* packet, const enet_uint8 channel)
 {
-    if (!player_) {
+    // The stream below reads straight out of the packet, so it is only freed
+    // once forwarding is done.
+    std::unique_ptr<ENetPacket, decltype(&enet_packet_destroy)> packet_guard{ packet, &enet_packet_destroy };
+
+    auto* session{ static_cast<core::Session*>(peer->data) };
+    if (capture_) {
+        capture_->write(
+            core::EventFrom::FromServer,
+            session ? session->get_id() : 0,
+            channel,
+            packet->flags,
+            { reinterpret_cast<const std::byte*>(packet->data), packet->dataLength }
+        );
+    }
+
+    if (flight_recorder_) {
+        flight_recorder_->record(
+            core::EventFrom::FromServer,
+            session ? session->get_id() : 0,
+            channel,
+            packet->flags,
+            { reinterpret_cast<const std::byte*>(packet->data), packet->dataLength }
+        );
+    }
+
+    const auto player{ session ? session->get_upstream() : nullptr };
+    if (!player) {
         enet_peer_disconnect(peer, 0);
         return;
     }
 
-    player::Player* to_player{ core_->get_server()->get_player() };
+    const auto to_player{ session->get_downstream() };
     if (!to_player) {
-        player_->disconnect();
+        player->disconnect();
         return;
     }
 
-    ByteStream byte_stream{ reinterpret_cast<std::byte*>(packet->data), packet->dataLength };
+    // Untouched traffic goes out as the very packet we received, so forwarding
+    // neither copies nor allocates. Nothing may read byte_stream afterwards.
+    // Reliability and channel are carried over unless overridden per type.
+    packet::ForwardRoute route{ packet->flags & packet::forwarded_flags, channel };
+    const auto forward_original{ [&] {
+        ENetPacket* original{ packet_guard.release() };
+        original->flags = route.flags;
+        std::ignore = to_player->send_packet(original, route.channel);
+    } };
+
+    ByteStreamView byte_stream{ reinterpret_cast<const std::byte*>(packet->data), packet->dataLength };
     if (byte_stream.get_size() < 4 /* || byte_stream.get_size() > 786432 */ /* 768kb */) {
-        player_->disconnect();
+        player->disconnect();
         return;
     }
 
-    enet_packet_destroy(packet);
-
     packet::NetMessageType type{};
     if (!byte_stream.read(type)) {
-        player_->disconnect();
+        player->disconnect();
         return;
     }
 
     if (type == packet::NET_MESSAGE_SERVER_HELLO) {
-        packet::core::ServerHello server_hello{};
-        packet::PacketHelper::send(server_hello, *to_player);
+        // The game client was greeted by our server already and has been
+        // waiting with its login since.
+        if (auto held{ session->release_held() }; held) {
+            for (core::HeldPacket& held_packet : *held) {
+                std::ignore = player->send_packet(held_packet.packet.release(), held_packet.channel);
+            }
+        }
+        else {
+            packet::core::ServerHello server_hello{};
+            packet::PacketHelper::send(server_hello, *to_player);
+        }
     }
     else if (type == packet::NET_MESSAGE_GENERIC_TEXT || type == packet::NET_MESSAGE_GAME_MESSAGE) {
-        std::string message{};
-        byte_stream.read(message, byte_stream.get_size() - sizeof(packet::NetMessageType) - 1);
-
-        TextParse text_parse{ message };
+        // The text stays in the receive buffer; only its index is built.
+        std::span<const std::byte> text{};
+        std::ignore = byte_stream.read_span(text, byte_stream.get_size() - sizeof(packet::NetMessageType) - 1);
+        message_view_.parse({ reinterpret_cast<const char*>(text.data()), text.size() });
 
-        if (core_->get_config().get<bool>("log.printMessage")) {
-            spdlog::info("Incoming message from server:");
-            for (const auto& key_value : text_parse.get_key_values()) {
-                spdlog::info("\t{}", key_value);
-            }
+        if (core_->get_config().get_snapshot().log_print_message) {
+            core::PacketLog::write(core::PacketLogKind::Message, core::EventFrom::FromServer, text);
         }
 
-        const core::EventMessage event_message{ *player_, *to_player, text_parse };
+        const core::EventMessage event_message{ session, *player, *to_player, message_view_ };
         event_message.from = core::EventFrom::FromServer;
-        core_->get_event_dispatcher().dispatch(event_message);
+        core_->dispatch(event_message);
+
+        if (event_message.canceled) {
+            return;
+        }
 
-        if (!event_message.canceled) {
-            std::ignore = to_player->send_packet(byte_stream.get_data(), 0);
+        // Edited messages are re-encoded; the rest go out as received.
+        if (event_message.is_dirty()) {
+            std::ignore = to_player->send_packet(event_message.serialize(type), route.channel, route.flags);
+        }
+        else {
+            forward_original();
         }
     }
     else if (type == packet::NET_MESSAGE_GAME_PACKET) {
         packet::GameUpdatePacket game_update_packet{};
         byte_stream.read(game_update_packet);
 
-        std::vector<std::byte> ext_data{};
-        if (game_update_packet.data_size > 0) {
-            byte_stream.read_vector(ext_data, game_update_packet.data_size);
-        }
-
     if (game_update_packet.type ==
         packet::PacketType::PACKET_APP_INTEGRITY_FAIL)
       return;
 
         const core::EventPacket event_packet{
-            *player_,
+            session,
+            *player,
             *to_player,
             game_update_packet,
-            byte_stream.get_data(),
-            ext_data
+            byte_stream.get_data()
         };
         event_packet.from = core::EventFrom::FromServer;
-        core_->get_event_dispatcher().dispatch(event_packet);
-
-        if (core_->get_config().get<bool>("log.printGameUpdatePacket")) {
-            spdlog::info(
-                "Incoming GameUpdatePacket {} ({}) from server: {:p}\n  EXT({}/{})={:p}\n",
-                magic_enum::enum_name(game_update_packet.type),
-                magic_enum::enum_integer(game_update_packet.type),
-                spdlog::to_hex(byte_stream.get_data()),
-                game_update_packet.data_size,
-                ext_data.size(),
-                spdlog::to_hex(ext_data)
-            );
+        core_->dispatch(event_packet);
+
+        if (core_->get_config().get_snapshot().log_print_game_update_packet) {
+            core::PacketLog::write(core::PacketLogKind::GameUpdatePacket, core::EventFrom::FromServer, event_packet.get_data());
         }
 
         if (!event_packet.canceled) {
-            std::ignore = to_player->send_packet(byte_stream.get_data(), 0);
+            core_->get_forward_overrides().apply(game_update_packet.type, route);
+
+            // Header edits are patched into the received packet; only replaced
+            // extended data costs a new one.
+            const std::span<std::byte> buffer{ reinterpret_cast<std::byte*>(packet->data), packet->dataLength };
+            if (const auto rebuilt{ event_packet.write_back(buffer) }; rebuilt) {
+                std::ignore = to_player->send_packet(*rebuilt, route.channel, route.flags);
+            }
+            else {
+                forward_original();
+            }
         }
     }
     else {
@@ -209,7 +357,7 @@ void Client::on_receive(ENetPeer* peer, ENetPacket* packet)
             peer->address.port
         );
         spdlog::warn("\t{} ({})", magic_enum::enum_name(type), magic_enum::enum_integer(type));
-        std::ignore = to_player->send_packet(byte_stream.get_data(), 0);
+        forward_original();
     }
 }
 
@@ -221,24 +369,30 @@ void Client::on_disconnect(ENetPeer* peer)
         peer->address.port
     );
 
-    if (!player_) {
+    auto* session{ static_cast<core::Session*>(peer->data) };
+    if (!session) {
         return;
     }
 
-    const core::EventDisconnection event_disconnection{ *player_ };
-    event_disconnection.from = core::EventFrom::FromServer;
-    core_->get_event_dispatcher().dispatch(event_disconnection);
+    peer->data = nullptr;
 
-    delete player_;
-    player_ = nullptr;
+    // Null if the connection attempt itself timed out.
+    if (const auto player{ session->detach_upstream() }; player) {
+        const core::EventDisconnection event_disconnection{ session, *player };
+        event_disconnection.from = core::EventFrom::FromServer;
+        core_->get_event_dispatcher().dispatch(event_disconnection);
+    }
 
-    const player::Player* to_player{ core_->get_server()->get_player() };
-    if (!to_player) {
-        return;
+    if (const auto to_player{ session->get_downstream() }; to_player) {
+        enet_host_flush(host_); // Flush all outgoing packets before disconnecting
+        // The server loop resets its peer and runs its own on_disconnect.
+        to_player->disconnect_now();
+    }
+
+    if (flight_recorder_) {
+        flight_recorder_->dump(session->get_id(), "disconnect");
     }
 
-    enet_host_flush(host_); // Flush all outgoing packets before disconnecting
-    to_player->disconnect_now();
-    core_->get_server()->on_disconnect(to_player->get_peer());
+    core_->get_sessions().release(*session);
 }
 }
@@ -0,0 +1,299 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <enet/enet.h>
+
+#include "spsc_queue.hpp"
+
+namespace core {
+/**
+ * @brief Hands ENet operations over to the thread that services a host.
+ *
+ * ENet is not thread-safe, so nothing but the thread running a host's service
+ * loop may touch that host or its peers. Anything else (the other host's loop,
+ * extension threads, the web server) pushes a command here and the owning loop
+ * executes it on its next drain.
+ *
+ * Commands arrive through one of three lanes, picked by the pushing thread:
+ * - local: the thread that drains this queue, no synchronisation at all.
+ * - relay: the thread servicing the partner host, a lock-free SPSC ring. This
+ *   carries every forwarded packet. When the ring is full, commands spill into
+ *   a mutex-guarded overflow that is drained after the ring, so the partner
+ *   never waits on this queue and order is kept.
+ * - foreign: any other thread, guarded by a mutex.
+ */
+class CommandQueue {
+public:
+    enum class CommandType : uint8_t {
+        Send,
+        Connect,
+        Disconnect,
+        DisconnectNow,
+        DisconnectLater
+    };
+
+    struct Command {
+        CommandType type;
+        ENetPeer* peer;
+        ENetPacket* packet;
+        enet_uint8 channel;
+        ENetAddress address;
+        // Connect: stored in ENetPeer::data of the new peer.
+        void* data;
+    };
+
+    /**
+     * @brief Marks the calling thread as the one servicing a queue's host.
+     *
+     * Lets push() recognise its own host's thread, which uses the local lane,
+     * and the partner host's thread, which uses the relay lane. Nothing is
+     * recorded on the queue itself, so a later thread reusing this one's id
+     * is not mistaken for it.
+     */
+    class ServicingScope {
+    public:
+        explicit ServicingScope(CommandQueue& queue)
+            : previous_{ servicing_ }
+        {
+            servicing_ = &queue;
+        }
+
+        ~ServicingScope() { servicing_ = previous_; }
+
+        ServicingScope(const ServicingScope&) = delete;
+        ServicingScope& operator=(const ServicingScope&) = delete;
+
+    private:
+        CommandQueue* previous_;
+    };
+
+    CommandQueue() = default;
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    ~CommandQueue()
+    {
+        const auto destroy{ [](const Command& command) {
+            if (command.packet && command.packet->referenceCount == 0) {
+                enet_packet_destroy(command.packet);
+            }
+        } };
+
+        std::ranges::for_each(local_, destroy);
+        std::ranges::for_each(overflow_, destroy);
+        std::ranges::for_each(foreign_, destroy);
+
+        Command command{};
+        while (relay_.try_pop(command)) {
+            destroy(command);
+        }
+    }
+
+    // The queue of the other host; commands pushed while servicing it use the relay lane.
+    void set_partner(const CommandQueue* partner) { partner_ = partner; }
+
+    void push(const Command& command)
+    {
+        if (servicing_ == this) {
+            local_.push_back(command);
+            return;
+        }
+
+        if (servicing_ && servicing_ == partner_) {
+            push_relay(command);
+            return;
+        }
+
+        std::scoped_lock lock{ mutex_ };
+        foreign_.push_back(command);
+        has_foreign_.store(true, std::memory_order_release);
+    }
+
+    // Only meaningful on the thread that drains the queue.
+    [[nodiscard]] bool empty() const
+    {
+        return local_.empty()
+            && relay_.size() == 0
+            && !relay_spilled_.load(std::memory_order_acquire)
+            && !has_foreign_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Execute every pending command against the given host.
+     *
+     * Must only be called from the thread servicing the host.
+     *
+     * @param host The host owning the queued peers.
+     * @param on_disconnect_now Called after a peer was reset by DisconnectNow,
+     *        since ENet does not generate a disconnect event for it.
+     * @param on_connect_failed Called with the command's data when Connect
+     *        found no free peer on the host.
+     * @return std::size_t The number of executed commands.
+     */
+    template <typename OnDisconnectNow, typename OnConnectFailed>
+    std::size_t drain(ENetHost* host, OnDisconnectNow&& on_disconnect_now, OnConnectFailed&& on_connect_failed)
+    {
+        const auto execute{ [&](const Command& command) {
+            execute_command(host, command, on_disconnect_now, on_connect_failed);
+        } };
+
+        std::size_t count{ 0 };
+
+        // Executing a command may push new local ones (e.g. from on_disconnect).
+        while (!local_.empty()) {
+            local_.swap(draining_local_);
+
+            for (const auto& command : draining_local_) {
+                execute(command);
+            }
+
+            count += draining_local_.size();
+            draining_local_.clear();
+        }
+
+        Command command{};
+        while (relay_.try_pop(command)) {
+            execute(command);
+            count++;
+        }
+
+        if (relay_spilled_.load(std::memory_order_acquire)) {
+            {
+                // The partner pushes nothing to the ring while spilled, so
+                // whatever is left in it came before the overflow.
+                std::scoped_lock lock{ overflow_mutex_ };
+                while (relay_.try_pop(command)) {
+                    draining_overflow_.push_back(command);
+                }
+
+                draining_overflow_.insert(draining_overflow_.end(), overflow_.begin(), overflow_.end());
+                overflow_.clear();
+                relay_spilled_.store(false, std::memory_order_release);
+            }
+
+            for (const auto& overflow : draining_overflow_) {
+                execute(overflow);
+            }
+
+            count += draining_overflow_.size();
+            draining_overflow_.clear();
+        }
+
+        if (has_foreign_.load(std::memory_order_acquire)) {
+            {
+                std::scoped_lock lock{ mutex_ };
+                foreign_.swap(draining_foreign_);
+                has_foreign_.store(false, std::memory_order_relaxed);
+            }
+
+            for (const auto& foreign : draining_foreign_) {
+                execute(foreign);
+            }
+
+            count += draining_foreign_.size();
+            draining_foreign_.clear();
+        }
+
+        return count;
+    }
+
+    template <typename OnDisconnectNow>
+    std::size_t drain(ENetHost* host, OnDisconnectNow&& on_disconnect_now)
+    {
+        return drain(host, std::forward<OnDisconnectNow>(on_disconnect_now), [](void*) {});
+    }
+
+    // Commands waiting in the relay lane right now.
+    [[nodiscard]] std::size_t get_relay_depth() const { return relay_.size(); }
+    // Deepest the relay lane has been since startup.
+    [[nodiscard]] std::size_t get_relay_high_water() const { return relay_high_water_.load(std::memory_order_relaxed); }
+    // How often the partner thread found the relay ring full and spilled into the overflow.
+    [[nodiscard]] uint64_t get_relay_full_count() const { return relay_full_.load(std::memory_order_relaxed); }
+
+private:
+    // Only ever called from the partner's servicing thread, the ring's single producer.
+    void push_relay(const Command& command)
+    {
+        // Once a command has spilled, the ones after it follow until the next
+        // drain, so nothing overtakes it through the ring.
+        if (!relay_spilled_.load(std::memory_order_acquire) && relay_.try_push(command)) {
+            if (const std::size_t depth{ relay_.size() }; depth > relay_high_water_.load(std::memory_order_relaxed)) {
+                relay_high_water_.store(depth, std::memory_order_relaxed);
+            }
+
+            return;
+        }
+
+        relay_full_.fetch_add(1, std::memory_order_relaxed);
+
+        std::scoped_lock lock{ overflow_mutex_ };
+        overflow_.push_back(command);
+        relay_spilled_.store(true, std::memory_order_release);
+    }
+
+    template <typename OnDisconnectNow, typename OnConnectFailed>
+    static void execute_command(
+        ENetHost* host,
+        const Command& command,
+        OnDisconnectNow&& on_disconnect_now,
+        OnConnectFailed&& on_connect_failed
+    )
+    {
+        switch (command.type) {
+        case CommandType::Send:
+            if (enet_peer_send(command.peer, command.channel, command.packet) != 0) {
+                enet_packet_destroy(command.packet);
+            }
+            break;
+        case CommandType::Connect:
+            if (ENetPeer* peer{ enet_host_connect(host, &command.address, 2, 0) }; peer) {
+                peer->data = command.data;
+            }
+            else {
+                on_connect_failed(command.data);
+            }
+            break;
+        case CommandType::Disconnect:
+            enet_peer_disconnect(command.peer, 0);
+            break;
+        case CommandType::DisconnectNow:
+            if (command.peer->state == ENET_PEER_STATE_DISCONNECTED) {
+                break;
+            }
+
+            enet_peer_disconnect_now(command.peer, 0);
+            on_disconnect_now(command.peer);
+            break;
+        case CommandType::DisconnectLater:
+            enet_peer_disconnect_later(command.peer, 0);
+            break;
+        }
+    }
+
+    static constexpr std::size_t relay_capacity{ 4096 };
+
+    inline static thread_local CommandQueue* servicing_{ nullptr };
+
+    const CommandQueue* partner_{ nullptr };
+
+    std::vector<Command> local_;
+    std::vector<Command> draining_local_;
+
+    SpscQueue<Command, relay_capacity> relay_;
+    std::atomic<std::size_t> relay_high_water_{ 0 };
+    std::atomic<uint64_t> relay_full_{ 0 };
+
+    std::mutex overflow_mutex_;
+    std::atomic<bool> relay_spilled_{ false };
+    std::vector<Command> overflow_;
+    std::vector<Command> draining_overflow_;
+
+    std::mutex mutex_;
+    std::atomic<bool> has_foreign_{ false };
+    std::vector<Command> foreign_;
+    std::vector<Command> draining_foreign_;
+};
+}
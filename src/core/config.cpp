@@ -1,76 +1,130 @@
+#include <chrono>
+#include <filesystem>
 #include <fstream>
+#include <string_view>
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #include "config.hpp"
 
 namespace core {
-static const std::map<std::string, ConfigStorage> config_defaults{
-    { "enet.address", "127.0.0.1" },
-    { "enet.port", 16999 },
-    { "web_server.address", "www.growtopia1.com" },
-    { "client.game_version", "5.11" },
-    { "client.protocol", 312 },
-    { "client.dnsServer", "cloudflare" },
-    { "extension.ignore", std::vector<std::string>{ "0xdeadbeef" } },
-    { "log.printMessage", true },
-    { "log.printGameUpdatePacket", false },
-    { "log.printVariant", true },
-};
+static constexpr auto config_path{ "config.json" };
 
-Config::Config()
+static std::map<std::string, ConfigStorage> make_config_defaults()
 {
-    // Load configuration from file, if available
-    if (std::ifstream ifs{ "config.json" }; ifs.good()) {
-        spdlog::info("Loading config file \"config.json\"...");
+    const ConfigSnapshot defaults{};
 
-        nlohmann::json j{};
-        ifs >> j;
+    return {
+#define GTPROXY_CONFIG_DEFAULT(member, key, type, value, reload) { key, ConfigStorage{ std::in_place_type<type>, defaults.member } },
+        GTPROXY_CONFIG_SCHEMA(GTPROXY_CONFIG_DEFAULT)
+#undef GTPROXY_CONFIG_DEFAULT
+    };
+}
 
-        for (const auto& [key, value] : j.items()) {
-            if (value.is_number_unsigned()) {
-                config_[key] = value.get<unsigned int>();
-            }
-            else if (value.is_number_integer()) {
-                config_[key] = value.get<int>();
-            }
-            else if (value.is_string()) {
-                config_[key] = value.get<std::string>();
-            }
-            else if (value.is_boolean()) {
-                config_[key] = value.get<bool>();
-            }
-            else if (value.is_array()) {
-                if (!value.empty() && value[0].is_string()) {
-                    config_[key] = value.get<std::vector<std::string>>();
-                }
-                else {
-                    throw std::runtime_error{ "Invalid configuration array value type" };
-                }
+static const std::map<std::string, ConfigStorage> config_defaults{ make_config_defaults() };
+
+// Keeps the default if the key holds another type; numbers convert between signed and unsigned.
+template <typename T>
+static void load_snapshot_value(const ConfigStorage& storage, const std::string& key, T& value)
+{
+    std::visit([&]<typename U>(const U& stored) {
+        if constexpr (std::is_same_v<U, T>) {
+            value = stored;
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_integral_v<U> && !std::is_same_v<T, bool> && !std::is_same_v<U, bool>) {
+            value = static_cast<T>(stored);
+        }
+        else {
+            spdlog::warn("Configuration key \"{}\" has the wrong type, using the default value", key);
+        }
+    }, storage);
+}
+
+static ConfigSnapshot make_snapshot(const std::unordered_map<std::string, ConfigStorage>& config)
+{
+    ConfigSnapshot snapshot{};
+
+#define GTPROXY_CONFIG_LOAD(member, key, type, value, reload) \
+    if (const auto it{ config.find(key) }; it != config.end()) { \
+        load_snapshot_value(it->second, key, snapshot.member); \
+    }
+    GTPROXY_CONFIG_SCHEMA(GTPROXY_CONFIG_LOAD)
+#undef GTPROXY_CONFIG_LOAD
+
+    return snapshot;
+}
+
+static std::unordered_map<std::string, ConfigStorage> load_values(std::istream& is)
+{
+    std::unordered_map<std::string, ConfigStorage> config{};
+
+    nlohmann::json j{};
+    is >> j;
+
+    for (const auto& [key, value] : j.items()) {
+        if (value.is_number_unsigned()) {
+            config[key] = value.get<unsigned int>();
+        }
+        else if (value.is_number_integer()) {
+            config[key] = value.get<int>();
+        }
+        else if (value.is_string()) {
+            config[key] = value.get<std::string>();
+        }
+        else if (value.is_boolean()) {
+            config[key] = value.get<bool>();
+        }
+        else if (value.is_array()) {
+            // An empty list is a valid value, e.g. no overrides.
+            if (value.empty() || value[0].is_string()) {
+                config[key] = value.get<std::vector<std::string>>();
             }
             else {
-                throw std::runtime_error{ "Invalid configuration value type" };
+                throw std::runtime_error{ "Invalid configuration array value type" };
             }
         }
+        else {
+            throw std::runtime_error{ "Invalid configuration value type" };
+        }
+    }
+
+    return config;
+}
+
+Config::Config()
+    : state_{ std::make_shared<State>() }
+{
+    std::unordered_map<std::string, ConfigStorage> config{};
+
+    // Load configuration from file, if available
+    if (std::ifstream ifs{ config_path }; ifs.good()) {
+        spdlog::info("Loading config file \"{}\"...", config_path);
+        config = load_values(ifs);
     }
 
     // Set default values for missing configuration keys
     bool save_defaults{ false };
     for (const auto& [key, value] : config_defaults) {
-        if (config_.contains(key)) {
+        if (config.contains(key)) {
             continue;
         }
 
         spdlog::warn("Configuration key \"{}\" is missing, setting default value", key);
 
-        config_[key] = value;
+        config[key] = value;
         save_defaults = true;
     }
 
     // Save default values to file, if necessary
     if (save_defaults) {
         nlohmann::json j{};
-        for (const auto& [key, value] : config_) {
+        for (const auto& [key, value] : config) {
             std::visit([&]<typename U>(U val) {
                 using T = std::decay_t<decltype(val)>;
                 if constexpr (std::is_same_v<T, int>) {
@@ -91,10 +145,153 @@ Config::Config()
             }, value);
         }
 
-        std::ofstream ofs{ "config.json" };
+        std::ofstream ofs{ config_path };
         ofs << std::setw(4) << j << std::endl;
     }
 
-    spdlog::info("Config file \"config.json\" is all loaded up and ready to go!");
+    publish(*state_, std::move(config));
+
+    spdlog::info("Config file \"{}\" is all loaded up and ready to go!", config_path);
+}
+
+void Config::watch()
+{
+    std::scoped_lock lock{ state_->mutex };
+    if (state_->watcher.joinable()) {
+        return;
+    }
+
+    state_->watcher = std::jthread{ [state{ state_.get() }](const std::stop_token& stop) {
+        watch_file(*state, stop);
+    } };
+}
+
+bool Config::reload(State& state)
+{
+    std::unordered_map<std::string, ConfigStorage> config{};
+    try {
+        std::ifstream ifs{ config_path };
+        if (!ifs.good()) {
+            spdlog::warn("Config file \"{}\" is gone, keeping the running configuration", config_path);
+            return false;
+        }
+
+        config = load_values(ifs);
+    }
+    catch (const std::exception& ex) {
+        // Most likely an editor caught halfway through writing; the next change retries.
+        spdlog::warn("Config file \"{}\" is invalid, keeping the running configuration: {}", config_path, ex.what());
+        return false;
+    }
+
+    std::scoped_lock lock{ state.mutex };
+    const Generation& running{ *state.current.load(std::memory_order_relaxed) };
+
+    for (const auto& [key, value] : config_defaults) {
+        config.try_emplace(key, value);
+    }
+
+    // Whatever was built from these at startup keeps using the old value.
+    const auto keep_running{ [&](const std::string& key) {
+        ConfigStorage& value{ config[key] };
+        const ConfigStorage& running_value{ running.values.at(key) };
+        if (value != running_value) {
+            spdlog::warn("Configuration key \"{}\" changed, pending until restart", key);
+            value = running_value;
+        }
+    } };
+
+#define GTPROXY_CONFIG_KEEP(member, key, type, value, reload) \
+    if constexpr (reload == ConfigReload::Restart) { \
+        keep_running(key); \
+    }
+    GTPROXY_CONFIG_SCHEMA(GTPROXY_CONFIG_KEEP)
+#undef GTPROXY_CONFIG_KEEP
+
+    if (config == running.values) {
+        return false;
+    }
+
+    publish(state, std::move(config));
+    spdlog::info("Config file \"{}\" reloaded", config_path);
+    return true;
+}
+
+void Config::set(const std::string& key, ConfigStorage value)
+{
+    std::scoped_lock lock{ state_->mutex };
+
+    std::unordered_map values{ current().values };
+    values[key] = std::move(value);
+    publish(*state_, std::move(values));
+}
+
+void Config::publish(State& state, std::unordered_map<std::string, ConfigStorage> values)
+{
+    auto generation{ std::make_unique<Generation>() };
+    generation->snapshot = make_snapshot(values);
+    generation->values = std::move(values);
+
+    state.current.store(generation.get(), std::memory_order_release);
+    state.generations.push_back(std::move(generation));
+}
+
+void Config::watch_file(State& state, const std::stop_token& stop)
+{
+    constexpr int poll_interval_ms{ 500 };
+
+#ifdef __linux__
+    // Watch the directory rather than the file: editors tend to save by
+    // replacing the file, which would silently end a watch on the file itself.
+    if (const int fd{ inotify_init1(IN_NONBLOCK | IN_CLOEXEC) }; fd != -1) {
+        if (inotify_add_watch(fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO) != -1) {
+            while (!stop.stop_requested()) {
+                pollfd pfd{ fd, POLLIN, 0 };
+                if (poll(&pfd, 1, poll_interval_ms) <= 0) {
+                    continue;
+                }
+
+                alignas(inotify_event) char buffer[4096];
+                const ssize_t length{ read(fd, buffer, sizeof(buffer)) };
+
+                bool changed{ false };
+                for (ssize_t offset{ 0 }; offset < length;) {
+                    const auto* event{ reinterpret_cast<const inotify_event*>(buffer + offset) };
+                    if (event->len > 0 && std::string_view{ event->name } == config_path) {
+                        changed = true;
+                    }
+
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+
+                if (changed) {
+                    reload(state);
+                }
+            }
+
+            close(fd);
+            return;
+        }
+
+        close(fd);
+    }
+
+    spdlog::warn("Failed to watch \"{}\" with inotify, polling it instead", config_path);
+#endif
+
+    std::error_code ec{};
+    auto last_write{ std::filesystem::last_write_time(config_path, ec) };
+
+    while (!stop.stop_requested()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{ poll_interval_ms });
+
+        const auto write_time{ std::filesystem::last_write_time(config_path, ec) };
+        if (ec || write_time == last_write) {
+            continue;
+        }
+
+        last_write = write_time;
+        reload(state);
+    }
 }
 }
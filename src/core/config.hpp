@@ -1,11 +1,76 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace core {
 using ConfigStorage = std::variant<int, unsigned int, std::string, bool, std::vector<std::string>>;
 
+// Whether a key takes effect when config.json is reloaded, or only after a restart.
+enum class ConfigReload {
+    Live,
+    Restart
+};
+
+/**
+ * @brief Every configuration key: X(member, key, type, default value, reload).
+ *
+ * Generates both the defaults written to config.json and the members of
+ * ConfigSnapshot, so a key is only ever declared here.
+ */
+#define GTPROXY_CONFIG_SCHEMA(X) \
+    X(enet_address, "enet.address", std::string, "127.0.0.1", ConfigReload::Live) \
+    X(enet_port, "enet.port", unsigned int, 16999, ConfigReload::Restart) \
+    X(core_io_model, "core.ioModel", std::string, "async", ConfigReload::Restart) \
+    X(core_max_sessions, "core.maxSessions", unsigned int, 8, ConfigReload::Restart) \
+    X(core_shards, "core.shards", unsigned int, 1, ConfigReload::Restart) \
+    X(core_pin_shards, "core.pinShards", bool, false, ConfigReload::Restart) \
+    X(web_server_address, "web_server.address", std::string, "www.growtopia1.com", ConfigReload::Live) \
+    X(client_game_version, "client.game_version", std::string, "5.11", ConfigReload::Live) \
+    X(client_protocol, "client.protocol", int, 312, ConfigReload::Live) \
+    X(client_dns_server, "client.dnsServer", std::string, "cloudflare", ConfigReload::Live) \
+    X(client_upstream_address, "client.upstreamAddress", std::string, "", ConfigReload::Live) \
+    X(client_upstream_port, "client.upstreamPort", unsigned int, 17091, ConfigReload::Live) \
+    X(extension_ignore, "extension.ignore", std::vector<std::string>, { "0xdeadbeef" }, ConfigReload::Restart) \
+    X(forward_overrides, "forward.overrides", std::vector<std::string>, {}, ConfigReload::Restart) \
+    X(log_print_message, "log.printMessage", bool, true, ConfigReload::Live) \
+    X(log_print_game_update_packet, "log.printGameUpdatePacket", bool, false, ConfigReload::Live) \
+    X(log_print_variant, "log.printVariant", bool, true, ConfigReload::Live) \
+    X(log_async, "log.async", bool, false, ConfigReload::Restart) \
+    X(capture_enabled, "capture.enabled", bool, false, ConfigReload::Restart) \
+    X(capture_directory, "capture.directory", std::string, "captures", ConfigReload::Restart) \
+    X(capture_segment_size, "capture.segmentSize", unsigned int, 64, ConfigReload::Restart) \
+    X(capture_max_segments, "capture.maxSegments", unsigned int, 16, ConfigReload::Restart) \
+    X(flight_recorder_enabled, "flightRecorder.enabled", bool, true, ConfigReload::Restart) \
+    X(flight_recorder_directory, "flightRecorder.directory", std::string, "flight_recorder", ConfigReload::Restart) \
+    X(flight_recorder_seconds, "flightRecorder.seconds", unsigned int, 30, ConfigReload::Restart) \
+    X(flight_recorder_max_dumps, "flightRecorder.maxDumps", unsigned int, 64, ConfigReload::Restart)
+
+/**
+ * @brief The whole configuration as plain typed members.
+ *
+ * Built once the file is loaded; hot paths read it instead of Config::get, which
+ * hashes a string key on every call.
+ */
+struct ConfigSnapshot {
+#define GTPROXY_CONFIG_MEMBER(member, key, type, value, reload) type member = value;
+    GTPROXY_CONFIG_SCHEMA(GTPROXY_CONFIG_MEMBER)
+#undef GTPROXY_CONFIG_MEMBER
+};
+
+/**
+ * @brief The configuration loaded from config.json.
+ *
+ * Copies share one published generation, so a reload reaches every shard.
+ * Readers never lock: a reload builds a whole new generation and swaps one
+ * pointer. Old generations are retired rather than freed, as readers may still
+ * hold references into them; reloads are rare enough for that not to matter.
+ */
 class Config {
 public:
     Config();
@@ -15,14 +80,53 @@ public:
     [[nodiscard]] T get(const std::string& key) const
     {
         try {
-            return std::get<T>(config_.at(key));
+            return std::get<T>(current().values.at(key));
         }
         catch (const std::exception&) {
             return T{}; // or some other default value
         }
     }
 
+    // The generation current at the call; look it up again to see later reloads.
+    [[nodiscard]] const ConfigSnapshot& get_snapshot() const { return current().snapshot; }
+
+    /**
+     * @brief Re-read config.json and publish it if it is valid.
+     *
+     * Restart keys keep their running value and are reported as pending.
+     *
+     * @return true if a new generation was published.
+     */
+    bool reload() { return reload(*state_); }
+
+    // Reload whenever config.json changes on disk, until the last copy is gone.
+    void watch();
+
+    // Override one key for this run, without touching config.json; used by the tools.
+    void set(const std::string& key, ConfigStorage value);
+
 private:
-    std::unordered_map<std::string, ConfigStorage> config_;
+    struct Generation {
+        std::unordered_map<std::string, ConfigStorage> values;
+        ConfigSnapshot snapshot;
+    };
+
+    struct State {
+        std::atomic<const Generation*> current{ nullptr };
+
+        std::mutex mutex; // Serializes reloads
+        std::vector<std::unique_ptr<const Generation>> generations;
+
+        // Declared last so it is joined before anything it uses goes away.
+        std::jthread watcher;
+    };
+
+    [[nodiscard]] const Generation& current() const { return *state_->current.load(std::memory_order_acquire); }
+
+    static bool reload(State& state);
+    static void publish(State& state, std::unordered_map<std::string, ConfigStorage> values);
+    static void watch_file(State& state, const std::stop_token& stop);
+
+    std::shared_ptr<State> state_;
 };
 }
@@ -1,23 +1,49 @@
+#include <algorithm>
+#include <cstring>
 #include <future>
 #include <chrono>
+#include <thread>
 #include <enet/enet.h>
 #include <spdlog/spdlog.h>
 
 #include "core.hpp"
+#include "enet_pool.hpp"
+#include "reactor.hpp"
+#include "../utils/byte_stream.hpp"
 #include "../client/client.hpp"
 #include "../server/server.hpp"
 
 namespace core {
 Core::Core()
-    : run_{ true }
+    : Core{ Config{}, std::make_shared<RedirectTable>(), 0, 1 }
+{
+
+}
+
+Core::Core(
+    const Config& config,
+    std::shared_ptr<RedirectTable> redirects,
+    const std::size_t shard,
+    const std::size_t shard_count
+)
+    : config_{ config }
+    , redirects_{ std::move(redirects) }
+    , forward_overrides_{ config_.get<std::vector<std::string>>("forward.overrides") }
+    , shard_{ shard }
+    , shard_count_{ shard_count }
+    , run_{ true }
     , tick_{ 0 }
 {
-    if (enet_initialize() != 0) {
+    if (EnetPool::initialize() != 0) {
         throw std::runtime_error{ "Failed to initialize ENet" };
     }
 
     server_ = new server::Server{ this };
     client_ = new client::Client{ this };
+
+    // Packets relayed between the hosts go through the lock-free lanes.
+    server_->get_command_queue().set_partner(&client_->get_command_queue());
+    client_->get_command_queue().set_partner(&server_->get_command_queue());
 }
 
 Core::~Core()
@@ -47,6 +73,37 @@ void Core::run()
         ext->init();
     }
 
+    std::string io_model{ config_.get("core.ioModel") };
+
+    // A shard is one thread with its own CPU; the other models split it over
+    // three threads that hand packets to each other.
+    if (shard_count_ > 1 && io_model != "reactor") {
+        if (shard_ == 0) {
+            spdlog::warn("core.ioModel \"{}\" is ignored with {} shards, every shard runs \"reactor\"", io_model, shard_count_);
+        }
+
+        io_model = "reactor";
+    }
+
+    if (io_model == "threaded") {
+        spdlog::info("Running with one I/O thread per host");
+        run_threaded();
+    }
+    else if (io_model == "reactor") {
+        spdlog::info("Running both hosts from a single epoll reactor");
+        run_reactor();
+    }
+    else {
+        if (io_model != "async") {
+            spdlog::warn("Unknown core.ioModel \"{}\", falling back to \"async\"", io_model);
+        }
+
+        run_async();
+    }
+}
+
+void Core::run_async()
+{
     constexpr std::chrono::microseconds sleep_timer{ static_cast<int>(5.0f * 1000.0f) };
     auto prev{ std::chrono::high_resolution_clock::now() };
     std::chrono::microseconds sleep_duration{ sleep_timer };
@@ -68,11 +125,7 @@ void Core::run()
         server_future.get();
         client_future.get();
 
-        // Call the tick callback
-        event_dispatcher_.dispatch(EventTick{}); // TODO: Pass tick related arguments to the callback
-        for (const auto& ext : std::views::values(extensions_)) {
-            ext->tick();
-        }
+        tick();
 
         if (sleep_duration > std::chrono::microseconds::zero()) {
             std::this_thread::sleep_for(sleep_duration);
@@ -82,8 +135,186 @@ void Core::run()
         if (sleep_duration >= sleep_timer) {
             sleep_duration = std::chrono::microseconds::zero();
         }
+    }
+}
+
+void Core::run_threaded()
+{
+    // A short service timeout bounds how long a packet queued by the other
+    // host's thread waits before it is sent.
+    constexpr enet_uint32 service_timeout{ 1 };
+
+    std::thread client_thread{ [this] {
+        while (run_) {
+            client_->process(service_timeout);
+        }
+    } };
+
+    // This thread owns the server host. Ticking between its service calls
+    // keeps ticks out of the server host's dispatches.
+    constexpr std::chrono::milliseconds tick_interval{ 5 };
+    auto next_tick{ std::chrono::steady_clock::now() };
+
+    while (run_) {
+        server_->process(service_timeout);
+
+        if (const auto now{ std::chrono::steady_clock::now() }; now >= next_tick) {
+            tick();
+
+            // Skip missed ticks instead of bursting to catch up.
+            next_tick = std::max(next_tick + tick_interval, now);
+        }
+    }
+
+    client_thread.join();
+}
+
+void Core::run_reactor()
+{
+    const Reactor reactor{ server_->get_host(), client_->get_host() };
+    if (!reactor.is_open()) {
+        spdlog::warn("The reactor is not available on this platform, falling back to \"threaded\"");
+        run_threaded();
+        return;
+    }
+
+    constexpr std::chrono::microseconds tick_interval{ 5000 };
+    auto next_tick{ std::chrono::steady_clock::now() + tick_interval };
+
+    while (run_) {
+        // Never block inside ENet; the reactor does the waiting for both hosts.
+        server_->process(0);
+        client_->process(0);
+
+        auto now{ std::chrono::steady_clock::now() };
+        if (now >= next_tick) {
+            tick();
+
+            // Skip missed ticks instead of bursting to catch up.
+            next_tick = std::max(next_tick + tick_interval, now);
+            now = std::chrono::steady_clock::now();
+        }
 
-        tick_++;
+        // Relaying from one host queues work on the other; run it right away.
+        if (!server_->get_command_queue().empty() || !client_->get_command_queue().empty()) {
+            continue;
+        }
+
+        reactor.wait(std::chrono::duration_cast<std::chrono::microseconds>(next_tick - now));
+    }
+}
+
+std::vector<std::byte> EventMessage::serialize(const packet::NetMessageType type) const
+{
+    ByteStream byte_stream{};
+    byte_stream.write(type);
+    byte_stream.write(get_message().get_raw(), false);
+    byte_stream.write<char>(0);
+
+    return byte_stream.get_data();
+}
+
+std::optional<std::vector<std::byte>> EventPacket::write_back(const std::span<std::byte> buffer) const
+{
+    if (!ext_data_) {
+        // A packet too short to hold a header has nowhere to patch one into.
+        if (header_dirty_ && buffer.size() >= header_end) {
+            // The extended data stays as received, and so must its size.
+            packet::GameUpdatePacket header{ *packet_ };
+            header.data_size = ext_size_;
+            std::memcpy(buffer.data() + sizeof(packet::NetMessageType), &header, sizeof(packet::GameUpdatePacket));
+        }
+
+        return std::nullopt;
+    }
+
+    const std::span<const std::byte> ext_data{ *ext_data_ };
+
+    packet::GameUpdatePacket header{ *packet_ };
+    header.data_size = static_cast<uint32_t>(ext_data.size());
+    header.flags.extended = !ext_data.empty();
+
+    // Whatever followed the original extended data is kept after the new one.
+    std::span<const std::byte> trailing{};
+    if (data_.size() >= header_end && data_.size() - header_end >= ext_size_) {
+        trailing = data_.subspan(header_end + ext_size_);
     }
+
+    ByteStream byte_stream{};
+    byte_stream.write_data(data_.data(), std::min(data_.size(), sizeof(packet::NetMessageType)));
+    byte_stream.write(header);
+    byte_stream.write_data(ext_data.data(), ext_data.size());
+    byte_stream.write_data(trailing.data(), trailing.size());
+
+    return byte_stream.get_data();
+}
+
+void Core::dispatch(const EventPacket& event)
+{
+    const auto started{ dispatch_timer_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} };
+
+    packet_dispatcher_.dispatch(event);
+    if (!event.canceled) {
+        event_dispatcher_.dispatch(event);
+    }
+
+    if (dispatch_timer_) {
+        dispatch_timer_(event.from, std::chrono::steady_clock::now() - started);
+    }
+}
+
+void Core::dispatch(const EventMessage& event)
+{
+    const auto started{ dispatch_timer_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} };
+
+    event_dispatcher_.dispatch(event);
+
+    if (dispatch_timer_) {
+        dispatch_timer_(event.from, std::chrono::steady_clock::now() - started);
+    }
+}
+
+void Core::tick()
+{
+    event_dispatcher_.dispatch(EventTick{}); // TODO: Pass tick related arguments to the callback
+    for (const auto& ext : std::views::values(extensions_)) {
+        ext->tick();
+    }
+
+    // Report relay queue pressure roughly every five seconds.
+    if (tick_ % 1000 == 0) {
+        const CommandQueue& to_client{ server_->get_command_queue() };
+        const CommandQueue& to_server{ client_->get_command_queue() };
+
+        spdlog::debug(
+            "Relay queue depth: server->client {} (max {}, {} spilled), client->server {} (max {}, {} spilled)",
+            to_client.get_relay_depth(),
+            to_client.get_relay_high_water(),
+            to_client.get_relay_full_count(),
+            to_server.get_relay_depth(),
+            to_server.get_relay_high_water(),
+            to_server.get_relay_full_count()
+        );
+
+        // The pool is shared by every shard, so only the first one reports it.
+        if (shard_ == 0) {
+            for (const auto& stats : EnetPool::get_stats()) {
+                spdlog::debug(
+                    "ENet pool {}B blocks: {} hits, {} misses, {} in use (max {})",
+                    stats.block_size,
+                    stats.hits,
+                    stats.misses,
+                    stats.in_use,
+                    stats.high_water
+                );
+            }
+
+            if (const uint64_t oversized{ EnetPool::get_oversized_count() }; oversized != 0) {
+                spdlog::debug("ENet pool: {} allocations too large to pool", oversized);
+            }
+        }
+    }
+
+    tick_++;
 }
 }
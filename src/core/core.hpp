@@ -1,9 +1,19 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <eventpp/callbacklist.h>
 #include <eventpp/hetereventdispatcher.h>
 #include <eventpp/utilities/eventmaker.h>
 
 #include "config.hpp"
+#include "session.hpp"
 #include "../extension/extension.hpp"
+#include "../packet/forward_overrides.hpp"
 #include "../packet/packet_types.hpp"
 #include "../player/player.hpp"
 #include "../utils/text_parse.hpp"
@@ -68,29 +78,171 @@ EVENTPP_MAKE_EMPTY_EVENT(
 
 EVENTPP_MAKE_EVENT(
     EventConnection, Event, (EventType::Connection, EventFrom::FromAny),
+    G(SessionPtr, session),
     G(player::Player, player)
 );
 
 EVENTPP_MAKE_EVENT(
     EventDisconnection, Event, (EventType::Disconnection, EventFrom::FromAny),
+    G(SessionPtr, session),
     G(player::Player, player)
 );
 
-EVENTPP_MAKE_EVENT(
-    EventMessage, Event, (EventType::Message, EventFrom::FromAny),
-    G(player::Player, player),
-    G(player::Player, target),
-    G(TextParse, message)
-);
+/**
+ * @brief A text message passing through the proxy.
+ *
+ * The message is an index into the received packet; get_view() reads it without
+ * copying. get_message() and edit_message() build an owning TextParse on first
+ * use, and only an edited message is re-encoded for forwarding, otherwise the
+ * received packet goes out untouched.
+ */
+class EventMessage : public Event {
+public:
+    EventMessage(
+        Session* session,
+        const player::Player& player,
+        const player::Player& target,
+        const TextParseView& message
+    )
+        : Event{ EventType::Message, EventFrom::FromAny }
+        , session_{ session }
+        , player_{ &player }
+        , target_{ &target }
+        , view_{ &message }
+        , dirty_{ false }
+    {
 
-EVENTPP_MAKE_EVENT(
-    EventPacket, Event, (EventType::Packet, EventFrom::FromAny),
-    G(player::Player, player),
-    G(player::Player, target),
-    G(packet::GameUpdatePacket, packet),
-    G(std::vector<std::byte>, data),
-    G(std::vector<std::byte>, ext_data)
-);
+    }
+
+    [[nodiscard]] Session* get_session() const { return session_; }
+    [[nodiscard]] const player::Player& get_player() const { return *player_; }
+    [[nodiscard]] const player::Player& get_target() const { return *target_; }
+    [[nodiscard]] const TextParseView& get_view() const { return *view_; }
+
+    [[nodiscard]] const TextParse& get_message() const
+    {
+        if (!message_) {
+            message_.emplace(*view_);
+        }
+
+        return *message_;
+    }
+
+    [[nodiscard]] TextParse& edit_message() const
+    {
+        static_cast<void>(get_message());
+        dirty_ = true;
+        return *message_;
+    }
+
+    [[nodiscard]] bool is_dirty() const { return dirty_; }
+
+    // The (edited) message encoded as a packet of the given type.
+    [[nodiscard]] std::vector<std::byte> serialize(packet::NetMessageType type) const;
+
+private:
+    Session* session_;
+    const player::Player* player_;
+    const player::Player* target_;
+    const TextParseView* view_;
+    mutable std::optional<TextParse> message_;
+    mutable bool dirty_;
+};
+
+/**
+ * @brief A game packet passing through the proxy.
+ *
+ * Written by hand rather than with EVENTPP_MAKE_EVENT so it only refers to the
+ * receive buffer and to objects owned by the caller; building one costs no
+ * allocation. None of it may be kept past dispatch.
+ *
+ * Listeners may edit the header through edit_packet() and replace the extended
+ * data through set_ext_data(). write_back() then re-serializes only what was
+ * touched.
+ */
+class EventPacket : public Event {
+public:
+    /**
+     * @param data The whole packet, message type included.
+     */
+    EventPacket(
+        Session* session,
+        const player::Player& player,
+        const player::Player& target,
+        packet::GameUpdatePacket& packet,
+        const std::span<const std::byte> data
+    )
+        : Event{ EventType::Packet, EventFrom::FromAny }
+        , session_{ session }
+        , player_{ &player }
+        , target_{ &target }
+        , packet_{ &packet }
+        , data_{ data }
+        , ext_size_{ packet.data_size }
+        , header_dirty_{ false }
+    {
+
+    }
+
+    [[nodiscard]] Session* get_session() const { return session_; }
+    [[nodiscard]] const player::Player& get_player() const { return *player_; }
+    [[nodiscard]] const player::Player& get_target() const { return *target_; }
+    [[nodiscard]] const packet::GameUpdatePacket& get_packet() const { return *packet_; }
+    // The packet as received, message type included; edits are not reflected here.
+    [[nodiscard]] std::span<const std::byte> get_data() const { return data_; }
+
+    // The extended data after the header, or nothing if the packet is too short to hold it.
+    [[nodiscard]] std::span<const std::byte> get_ext_data() const
+    {
+        if (ext_data_) {
+            return *ext_data_;
+        }
+
+        if (data_.size() < header_end || data_.size() - header_end < ext_size_) {
+            return {};
+        }
+
+        return data_.subspan(header_end, ext_size_);
+    }
+
+    [[nodiscard]] packet::GameUpdatePacket& edit_packet() const
+    {
+        header_dirty_ = true;
+        return *packet_;
+    }
+
+    void set_ext_data(std::vector<std::byte> ext_data) const { ext_data_ = std::move(ext_data); }
+
+    [[nodiscard]] bool is_dirty() const { return header_dirty_ || ext_data_.has_value(); }
+
+    /**
+     * @brief Write the edits back so the packet can be forwarded.
+     *
+     * An edited header is patched into the receive buffer in place; the
+     * GameUpdatePacket the event was made from is left alone. Only replaced
+     * extended data needs a new buffer, which keeps any bytes that followed
+     * the original extended data. Unedited packets, and packets too short to
+     * hold a header, are forwarded as received.
+     *
+     * @param buffer The writable receive buffer that get_data() views.
+     * @return std::optional<std::vector<std::byte>> The rebuilt packet, or
+     *         nothing when the receive buffer is ready to forward as is.
+     */
+    [[nodiscard]] std::optional<std::vector<std::byte>> write_back(std::span<std::byte> buffer) const;
+
+private:
+    static constexpr std::size_t header_end{ sizeof(packet::NetMessageType) + sizeof(packet::GameUpdatePacket) };
+
+    Session* session_;
+    const player::Player* player_;
+    const player::Player* target_;
+    packet::GameUpdatePacket* packet_;
+    std::span<const std::byte> data_;
+    uint32_t ext_size_;
+
+    mutable bool header_dirty_;
+    mutable std::optional<std::vector<std::byte>> ext_data_;
+};
 
 struct EventPolicies {
     using ArgumentPassingMode = eventpp::ArgumentPassingIncludeEvent;
@@ -112,9 +264,72 @@ using EventDispatcher = eventpp::HeterEventDispatcher<
     EventPolicies
 >;
 
+/**
+ * @brief Packet listeners indexed by PacketType and direction.
+ *
+ * A listener only runs for the packet type it subscribed to, so a flood of one
+ * type never wakes up listeners of another. The table is flat: one callback
+ * list per type for each direction.
+ */
+class PacketDispatcher {
+public:
+    using CallbackList = eventpp::CallbackList<void(const EventPacket&), EventPolicies>;
+    using Callback = CallbackList::Callback;
+
+    // FromAny subscribes to both directions.
+    void append_listener(const packet::PacketType type, const EventFrom from, const Callback& callback)
+    {
+        for_each_direction(type, from, [&](CallbackList& list) { list.append(callback); });
+    }
+
+    void prepend_listener(const packet::PacketType type, const EventFrom from, const Callback& callback)
+    {
+        for_each_direction(type, from, [&](CallbackList& list) { list.prepend(callback); });
+    }
+
+    void dispatch(const EventPacket& event) const
+    {
+        const CallbackList& list{ lists_[index(event.get_packet().type, event.from)] };
+        if (!list.empty()) {
+            list(event);
+        }
+    }
+
+private:
+    static constexpr std::size_t type_count{ 256 };
+
+    static std::size_t index(const packet::PacketType type, const EventFrom from)
+    {
+        return (from == EventFrom::FromServer ? type_count : 0) + magic_enum::enum_integer(type);
+    }
+
+    template <typename Func>
+    void for_each_direction(const packet::PacketType type, const EventFrom from, Func&& func)
+    {
+        if (from != EventFrom::FromServer) {
+            func(lists_[index(type, EventFrom::FromClient)]);
+        }
+
+        if (from != EventFrom::FromClient) {
+            func(lists_[index(type, EventFrom::FromServer)]);
+        }
+    }
+
+    std::array<CallbackList, type_count * 2> lists_;
+};
+
 class Core final : public extension::Extensible {
 public:
     Core();
+    /**
+     * @brief Construct one shard of a ShardGroup.
+     *
+     * @param config The configuration; copies share its reloads.
+     * @param redirects Redirects shared by every shard.
+     * @param shard Index of this shard, 0 being the first.
+     * @param shard_count The number of shards listening on enet.port.
+     */
+    Core(const Config& config, std::shared_ptr<RedirectTable> redirects, std::size_t shard, std::size_t shard_count);
     ~Core() override;
 
     bool add_extension(extension::IExtension* ext) override;
@@ -125,18 +340,54 @@ public:
     [[nodiscard]] Config& get_config() { return config_; }
     [[nodiscard]] server::Server* get_server() const { return server_; }
     [[nodiscard]] client::Client* get_client() const { return client_; }
+    [[nodiscard]] SessionTable& get_sessions() { return sessions_; }
+    [[nodiscard]] RedirectTable& get_redirects() const { return *redirects_; }
+    [[nodiscard]] const packet::ForwardOverrides& get_forward_overrides() const { return forward_overrides_; }
+
+    [[nodiscard]] std::size_t get_shard() const { return shard_; }
+    [[nodiscard]] std::size_t get_shard_count() const { return shard_count_; }
 
     [[nodiscard]] EventDispatcher& get_event_dispatcher() { return event_dispatcher_; }
+    [[nodiscard]] PacketDispatcher& get_packet_dispatcher() { return packet_dispatcher_; }
+
+    // Runs the listeners of the packet's type first, then the generic EventType::Packet ones.
+    void dispatch(const EventPacket& event);
+    void dispatch(const EventMessage& event);
+
+    using DispatchTimer = std::function<void(EventFrom from, std::chrono::steady_clock::duration elapsed)>;
+    /**
+     * @brief Be told how long every packet and message dispatch took, listeners included.
+     *
+     * For measuring tools like gtproxy-replay; without a timer dispatch reads no
+     * clock. Called on the host threads. Set before run().
+     */
+    void set_dispatch_timer(DispatchTimer timer) { dispatch_timer_ = std::move(timer); }
 
 private:
+    // Both hosts are serviced by fresh std::async tasks on every tick.
+    void run_async();
+    // Each host is owned by a long-lived thread; this one services the server host and ticks.
+    void run_threaded();
+    // Both hosts are serviced on this thread as soon as their sockets are readable.
+    void run_reactor();
+    void tick();
+
     Config config_;
+    SessionTable sessions_;
+    std::shared_ptr<RedirectTable> redirects_;
+    packet::ForwardOverrides forward_overrides_;
+
+    std::size_t shard_;
+    std::size_t shard_count_;
 
     server::Server* server_;
     client::Client* client_;
 
-    bool run_;
+    std::atomic<bool> run_;
     std::uint32_t tick_;
 
     EventDispatcher event_dispatcher_;
+    PacketDispatcher packet_dispatcher_;
+    DispatchTimer dispatch_timer_;
 };
 }
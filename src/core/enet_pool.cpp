@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <mutex>
+#include <enet/enet.h>
+
+#include "enet_pool.hpp"
+
+namespace core {
+namespace {
+// The smallest block is 32 bytes and the largest 1 MiB, which still holds a
+// reassembled world packet.
+constexpr std::size_t min_block_shift{ 5 };
+constexpr std::size_t class_count{ 16 };
+constexpr std::size_t oversized{ class_count };
+
+// Bytes a thread keeps cached per size class, within the block count limits.
+constexpr std::size_t cache_budget{ 1024 * 1024 };
+constexpr std::size_t min_cached_blocks{ 2 };
+constexpr std::size_t max_cached_blocks{ 256 };
+// The depot holds this many threads' worth of cached blocks per size class.
+constexpr std::size_t depot_caches{ 8 };
+
+// Sits in front of every block so enet_free knows where the block belongs.
+struct alignas(std::max_align_t) BlockHeader {
+    std::size_t size_class;
+    BlockHeader* next; // Only used while the block is on a free list
+};
+
+struct alignas(64) ClassCounters {
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<std::size_t> in_use;
+    std::atomic<std::size_t> high_water;
+};
+
+std::array<ClassCounters, class_count> counters{};
+std::atomic<uint64_t> oversized_count{ 0 };
+
+constexpr std::size_t block_size(const std::size_t size_class)
+{
+    return std::size_t{ 1 } << (size_class + min_block_shift);
+}
+
+constexpr std::size_t cache_limit(const std::size_t size_class)
+{
+    return std::clamp(cache_budget / block_size(size_class), min_cached_blocks, max_cached_blocks);
+}
+
+// Blocks moved between a thread cache and the depot at once.
+constexpr std::size_t batch_size(const std::size_t size_class)
+{
+    return std::max<std::size_t>(cache_limit(size_class) / 2, 1);
+}
+
+constexpr std::size_t size_class_of(const std::size_t size)
+{
+    if (size <= block_size(0)) {
+        return 0;
+    }
+
+    return std::min(static_cast<std::size_t>(std::bit_width(size - 1)) - min_block_shift, oversized);
+}
+
+// Detach the first count blocks of list, which has at least that many.
+BlockHeader* detach(BlockHeader*& list, const std::size_t count)
+{
+    BlockHeader* first{ list };
+    BlockHeader* last{ list };
+    for (std::size_t i{ 1 }; i < count; i++) {
+        last = last->next;
+    }
+
+    list = last->next;
+    last->next = nullptr;
+    return first;
+}
+
+void free_blocks(BlockHeader* block)
+{
+    while (block) {
+        BlockHeader* next{ block->next };
+        std::free(block);
+        block = next;
+    }
+}
+
+/**
+ * Per size class and shared by every thread. Thread caches refill from it when
+ * they run dry and spill into it when they are full, and an exiting thread
+ * leaves its cache here. So a block freed on the sending thread, or by a
+ * short-lived std::async thread, is reused instead of going back to malloc.
+ *
+ * Blocks left at exit are not freed, as other threads may still use the depot.
+ */
+struct alignas(64) Depot {
+    std::mutex mutex;
+    BlockHeader* head{ nullptr };
+    std::size_t count{ 0 };
+};
+
+std::array<Depot, class_count> depots{};
+
+// Take up to max blocks from the depot; the count taken is stored in taken.
+BlockHeader* depot_take(const std::size_t size_class, const std::size_t max, std::size_t& taken)
+{
+    Depot& depot{ depots[size_class] };
+    std::scoped_lock lock{ depot.mutex };
+
+    taken = std::min(depot.count, max);
+    if (taken == 0) {
+        return nullptr;
+    }
+
+    depot.count -= taken;
+    return detach(depot.head, taken);
+}
+
+// Give a chain of count blocks to the depot, or back to malloc if it is full.
+void depot_give(const std::size_t size_class, BlockHeader* chain, const std::size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    {
+        Depot& depot{ depots[size_class] };
+        std::scoped_lock lock{ depot.mutex };
+        if (depot.count + count <= cache_limit(size_class) * depot_caches) {
+            BlockHeader* last{ chain };
+            while (last->next) {
+                last = last->next;
+            }
+
+            last->next = depot.head;
+            depot.head = chain;
+            depot.count += count;
+            return;
+        }
+    }
+
+    free_blocks(chain);
+}
+
+class ThreadCache {
+public:
+    ThreadCache() = default;
+    ~ThreadCache();
+
+    ThreadCache(const ThreadCache&) = delete;
+    ThreadCache& operator=(const ThreadCache&) = delete;
+
+    BlockHeader* pop(const std::size_t size_class)
+    {
+        if (!heads_[size_class]) {
+            heads_[size_class] = depot_take(size_class, batch_size(size_class), counts_[size_class]);
+        }
+
+        BlockHeader* block{ heads_[size_class] };
+        if (block) {
+            heads_[size_class] = block->next;
+            counts_[size_class]--;
+        }
+
+        return block;
+    }
+
+    void push(BlockHeader* block)
+    {
+        const std::size_t size_class{ block->size_class };
+        if (counts_[size_class] >= cache_limit(size_class)) {
+            const std::size_t count{ batch_size(size_class) };
+            depot_give(size_class, detach(heads_[size_class], count), count);
+            counts_[size_class] -= count;
+        }
+
+        block->next = heads_[size_class];
+        heads_[size_class] = block;
+        counts_[size_class]++;
+    }
+
+private:
+    std::array<BlockHeader*, class_count> heads_{};
+    std::array<std::size_t, class_count> counts_{};
+};
+
+// Set once the thread's cache is destroyed; ENet may still free blocks from
+// other thread_local destructors after that.
+thread_local bool cache_gone{ false };
+thread_local ThreadCache cache{};
+
+ThreadCache::~ThreadCache()
+{
+    cache_gone = true;
+
+    for (std::size_t size_class{ 0 }; size_class < class_count; size_class++) {
+        depot_give(size_class, heads_[size_class], counts_[size_class]);
+    }
+}
+
+void* ENET_CALLBACK pool_malloc(const size_t size)
+{
+    const std::size_t size_class{ size_class_of(size) };
+    if (size_class == oversized) {
+        oversized_count.fetch_add(1, std::memory_order_relaxed);
+
+        auto* block{ static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size)) };
+        if (!block) {
+            return nullptr;
+        }
+
+        block->size_class = oversized;
+        return block + 1;
+    }
+
+    ClassCounters& counter{ counters[size_class] };
+
+    std::size_t taken{ 0 };
+    BlockHeader* block{ cache_gone ? depot_take(size_class, 1, taken) : cache.pop(size_class) };
+    if (block) {
+        counter.hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        counter.misses.fetch_add(1, std::memory_order_relaxed);
+
+        block = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + block_size(size_class)));
+        if (!block) {
+            return nullptr;
+        }
+
+        block->size_class = size_class;
+    }
+
+    const std::size_t in_use{ counter.in_use.fetch_add(1, std::memory_order_relaxed) + 1 };
+    std::size_t high_water{ counter.high_water.load(std::memory_order_relaxed) };
+    while (in_use > high_water
+        && !counter.high_water.compare_exchange_weak(high_water, in_use, std::memory_order_relaxed)) {
+    }
+
+    return block + 1;
+}
+
+void ENET_CALLBACK pool_free(void* memory)
+{
+    if (!memory) {
+        return;
+    }
+
+    BlockHeader* block{ static_cast<BlockHeader*>(memory) - 1 };
+    if (block->size_class == oversized) {
+        std::free(block);
+        return;
+    }
+
+    counters[block->size_class].in_use.fetch_sub(1, std::memory_order_relaxed);
+
+    if (cache_gone) {
+        block->next = nullptr;
+        depot_give(block->size_class, block, 1);
+        return;
+    }
+
+    cache.push(block);
+}
+}
+
+int EnetPool::initialize()
+{
+    // Shards construct their Cores concurrently, and ENet keeps its callbacks in
+    // a plain global, so only the first one installs them.
+    static std::once_flag install_flag{};
+
+    bool installed{ false };
+    int result{ 0 };
+    std::call_once(install_flag, [&] {
+        ENetCallbacks callbacks{};
+        callbacks.malloc = pool_malloc;
+        callbacks.free = pool_free;
+
+        installed = true;
+        result = enet_initialize_with_callbacks(ENET_VERSION, &callbacks);
+    });
+
+    return installed ? result : enet_initialize();
+}
+
+std::vector<EnetPool::ClassStats> EnetPool::get_stats()
+{
+    std::vector<ClassStats> stats{};
+    for (std::size_t size_class{ 0 }; size_class < class_count; size_class++) {
+        const ClassCounters& counter{ counters[size_class] };
+
+        const uint64_t hits{ counter.hits.load(std::memory_order_relaxed) };
+        const uint64_t misses{ counter.misses.load(std::memory_order_relaxed) };
+        if (hits == 0 && misses == 0) {
+            continue;
+        }
+
+        stats.push_back({
+            block_size(size_class),
+            hits,
+            misses,
+            counter.in_use.load(std::memory_order_relaxed),
+            counter.high_water.load(std::memory_order_relaxed)
+        });
+    }
+
+    return stats;
+}
+
+uint64_t EnetPool::get_oversized_count()
+{
+    return oversized_count.load(std::memory_order_relaxed);
+}
+}
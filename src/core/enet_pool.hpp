@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace core {
+/**
+ * @brief Size-class slab allocator behind enet_malloc and enet_free.
+ *
+ * Every ENet allocation (packets and their data, outgoing and incoming commands,
+ * fragment bitmaps and reassembly buffers) is rounded up to a power of two and
+ * served from a free list kept by the calling thread. Freed blocks go back to
+ * the freeing thread's list. A list that runs dry refills a batch from a depot
+ * shared by all threads, a full one spills a batch into it, and an exiting
+ * thread leaves its whole list there. That keeps blocks in use when a packet
+ * is received on one host thread and freed on the other, and when every tick
+ * runs on new std::async threads (core.ioModel "async"). Blocks beyond the
+ * depot's cap go back to malloc.
+ *
+ * The counters are process-wide and only approximate while hosts are running.
+ */
+class EnetPool {
+public:
+    struct ClassStats {
+        std::size_t block_size;
+        // Allocations served from a free list, a thread's or the shared depot.
+        uint64_t hits;
+        // Allocations that had to go to malloc.
+        uint64_t misses;
+        // Blocks handed out and not yet freed.
+        std::size_t in_use;
+        // The most blocks in use at once since startup.
+        std::size_t high_water;
+    };
+
+    /**
+     * @brief Install the pool as ENet's allocator, then initialize ENet.
+     *
+     * Safe to call once per Core; every call installs the same callbacks.
+     *
+     * @return int 0 on success, like enet_initialize.
+     */
+    static int initialize();
+
+    // Size classes that have seen any allocation.
+    [[nodiscard]] static std::vector<ClassStats> get_stats();
+    // Allocations larger than the biggest size class, passed straight to malloc.
+    [[nodiscard]] static uint64_t get_oversized_count();
+};
+}
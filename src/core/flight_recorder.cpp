@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+#include "flight_recorder.hpp"
+#include "packet_capture.hpp"
+
+namespace core {
+FlightRecorder::FlightRecorder(
+    std::filesystem::path directory,
+    std::string name,
+    const std::chrono::seconds window,
+    const std::size_t max_dumps
+)
+    : directory_{ std::move(directory) }
+    , name_{ std::move(name) }
+    , window_{ window }
+    , max_dumps_{ max_dumps }
+    , slots_{ std::make_unique<Slot[]>(slot_count) }
+    , next_{ 0 }
+    , requested_{ 0 }
+    , writer_{ [this](const std::stop_token& stop) { run(stop); } }
+{
+
+}
+
+void FlightRecorder::record(
+    const EventFrom from,
+    const uint32_t session,
+    const enet_uint8 channel,
+    const enet_uint32 flags,
+    const std::span<const std::byte> data
+)
+{
+    Slot& slot{ slots_[next_ % slot_count] };
+    slot.time = std::chrono::system_clock::now();
+    slot.session = session;
+    slot.from = from;
+    slot.channel = channel;
+    slot.flags = flags;
+    slot.original_size = static_cast<uint32_t>(data.size());
+    slot.size = static_cast<uint32_t>(std::min(data.size(), max_payload));
+    std::memcpy(slot.data.data(), data.data(), slot.size);
+
+    next_++;
+}
+
+void FlightRecorder::dump(const uint32_t session, const std::string_view reason)
+{
+    const auto since{ std::chrono::system_clock::now() - window_ };
+    const std::size_t first{ next_ - std::min(next_, slot_count) };
+
+    const auto matches{ [&](const Slot& slot) { return slot.session == session && slot.time >= since; } };
+
+    std::size_t count{ 0 };
+    std::size_t size{ 0 };
+    for (std::size_t i{ first }; i < next_; i++) {
+        if (const Slot& slot{ slots_[i % slot_count] }; matches(slot)) {
+            count++;
+            size += slot.size;
+        }
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    // Copy only what matched; the ring keeps being overwritten meanwhile.
+    Dump dump{ session, std::string{ reason }, {}, {} };
+    dump.records.reserve(count);
+    dump.data.reserve(size);
+    for (std::size_t i{ first }; i < next_; i++) {
+        const Slot& slot{ slots_[i % slot_count] };
+        if (!matches(slot)) {
+            continue;
+        }
+
+        dump.records.push_back({ slot.time, slot.from, slot.channel, slot.flags, slot.original_size, dump.data.size(), slot.size });
+        dump.data.insert(dump.data.end(), slot.data.begin(), slot.data.begin() + slot.size);
+    }
+
+    {
+        std::scoped_lock lock{ mutex_ };
+        if (pending_.size() >= max_pending) {
+            spdlog::warn("Flight recorder \"{}\" is behind; dropped the dump of session #{} ({})", name_, session, reason);
+            return;
+        }
+
+        pending_.push_back(std::move(dump));
+    }
+
+    pending_changed_.notify_one();
+}
+
+void FlightRecorder::service()
+{
+    if (requested_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    if (const uint32_t session{ requested_.exchange(0, std::memory_order_acquire) }; session != 0) {
+        dump(session, "request");
+    }
+}
+
+void FlightRecorder::run(const std::stop_token& stop)
+{
+    while (true) {
+        Dump dump{};
+        {
+            std::unique_lock lock{ mutex_ };
+            pending_changed_.wait(lock, stop, [this] { return !pending_.empty(); });
+
+            // Whatever is still pending at shutdown is written before stopping.
+            if (pending_.empty()) {
+                return;
+            }
+
+            dump = std::move(pending_.front());
+            pending_.pop_front();
+        }
+
+        write(dump);
+        prune();
+    }
+}
+
+void FlightRecorder::write(const Dump& dump) const
+{
+    // Exactly as large as the records need, so nothing is trimmed on close.
+    std::size_t size{ PacketCapture::get_file_header_size() };
+    for (const Record& record : dump.records) {
+        size += PacketCapture::get_record_size(record.size);
+    }
+
+    PacketCapture capture{ directory_, fmt::format("{}-session{}-{}", name_, dump.session, dump.reason), size, 1 };
+    for (const Record& record : dump.records) {
+        capture.write(
+            record.from,
+            dump.session,
+            record.channel,
+            record.flags,
+            std::span{ dump.data }.subspan(record.offset, record.size),
+            record.time,
+            record.original_size
+        );
+    }
+
+    spdlog::info(
+        "Flight recorder \"{}\" dumped {} packets of session #{} ({})",
+        name_,
+        dump.records.size(),
+        dump.session,
+        dump.reason
+    );
+}
+
+void FlightRecorder::prune() const
+{
+    if (max_dumps_ == 0) {
+        return;
+    }
+
+    const std::string prefix{ name_ + "-session" };
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> dumps{};
+
+    std::error_code ec{};
+    for (const auto& entry : std::filesystem::directory_iterator{ directory_, ec }) {
+        const std::filesystem::path& path{ entry.path() };
+        if (path.extension() == ".pcapng" && path.filename().string().starts_with(prefix)) {
+            std::error_code time_ec{};
+            dumps.emplace_back(entry.last_write_time(time_ec), path);
+        }
+    }
+
+    if (dumps.size() <= max_dumps_) {
+        return;
+    }
+
+    std::ranges::sort(dumps);
+    for (std::size_t i{ 0 }; i < dumps.size() - max_dumps_; i++) {
+        std::filesystem::remove(dumps[i].second, ec);
+    }
+}
+}
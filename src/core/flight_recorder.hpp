@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <enet/enet.h>
+
+#include "core.hpp"
+
+namespace core {
+/**
+ * @brief Keeps the most recent packets one host received, ready to be dumped.
+ *
+ * A fixed ring of slots allocated up front; recording copies at most the first
+ * max_payload bytes of a packet into the oldest slot, so it is cheap enough to
+ * leave on. A dump copies a session's packets from the last few seconds and
+ * hands them to a writer thread, which stores them as a pcapng file in the
+ * same format as PacketCapture and then deletes this recorder's oldest dumps
+ * beyond max_dumps.
+ *
+ * Owned by the host's thread: record(), dump() and service() must only be
+ * called from there. Other threads ask for a dump with request_dump().
+ */
+class FlightRecorder {
+public:
+    /**
+     * @param directory Where the dump files go, created if needed.
+     * @param name Prefix of the dump file names.
+     * @param window How far back a dump reaches.
+     * @param max_dumps Dump files with this name kept on disk, 0 for no limit.
+     */
+    FlightRecorder(std::filesystem::path directory, std::string name, std::chrono::seconds window, std::size_t max_dumps);
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    void record(EventFrom from, uint32_t session, enet_uint8 channel, enet_uint32 flags, std::span<const std::byte> data);
+
+    void dump(uint32_t session, std::string_view reason);
+
+    // Safe from any thread; only the latest request is kept until service() runs.
+    void request_dump(uint32_t session) { requested_.store(session, std::memory_order_release); }
+    // Perform a requested dump.
+    void service();
+
+private:
+    static constexpr std::size_t slot_count{ 2048 };
+    static constexpr std::size_t max_payload{ 1024 };
+    // Dumps waiting for the writer; more are dropped rather than queued.
+    static constexpr std::size_t max_pending{ 8 };
+
+    struct Slot {
+        std::chrono::system_clock::time_point time;
+        uint32_t session;
+        EventFrom from;
+        enet_uint8 channel;
+        enet_uint32 flags;
+        uint32_t original_size;
+        uint32_t size;
+        std::array<std::byte, max_payload> data;
+    };
+
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        EventFrom from;
+        enet_uint8 channel;
+        enet_uint32 flags;
+        uint32_t original_size;
+        // Where the payload starts in Dump::data.
+        std::size_t offset;
+        uint32_t size;
+    };
+
+    // A copy of one session's slots, written by the writer thread.
+    struct Dump {
+        uint32_t session;
+        std::string reason;
+        std::vector<Record> records;
+        std::vector<std::byte> data;
+    };
+
+    void run(const std::stop_token& stop);
+    void write(const Dump& dump) const;
+    void prune() const;
+
+    std::filesystem::path directory_;
+    std::string name_;
+    std::chrono::seconds window_;
+    std::size_t max_dumps_;
+
+    std::unique_ptr<Slot[]> slots_;
+    // Total packets recorded; the newest is at (next_ - 1) % slot_count.
+    std::size_t next_;
+
+    // Session waiting for a dump, 0 if none.
+    std::atomic<uint32_t> requested_;
+
+    std::mutex mutex_;
+    std::condition_variable_any pending_changed_;
+    std::deque<Dump> pending_;
+    // Last, so it writes what is pending and stops before the rest is destroyed.
+    std::jthread writer_;
+};
+}
@@ -0,0 +1,266 @@
+#include <chrono>
+#include <cstring>
+#include <tuple>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "packet_capture.hpp"
+#include "../packet/packet_types.hpp"
+
+namespace core {
+namespace {
+constexpr uint32_t section_header_block{ 0x0A0D0D0A };
+constexpr uint32_t interface_description_block{ 0x00000001 };
+constexpr uint32_t enhanced_packet_block{ 0x00000006 };
+constexpr uint16_t linktype_user0{ 147 };
+
+// Section header block plus one interface description block.
+constexpr std::size_t file_header_size{ 28 + 20 };
+// Enhanced packet block fields around the packet data.
+constexpr std::size_t record_overhead{ 32 };
+
+constexpr std::size_t pad4(const std::size_t size)
+{
+    return (size + 3) & ~std::size_t{ 3 };
+}
+
+template <typename T>
+std::byte* put(std::byte* out, const T value)
+{
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+}
+
+PacketCapture::PacketCapture(
+    std::filesystem::path directory,
+    std::string name,
+    const std::size_t segment_size,
+    const std::size_t max_segments
+)
+    : directory_{ std::move(directory) }
+    , name_{ std::move(name) }
+    , segment_size_{ std::max(segment_size, file_header_size + record_overhead + sizeof(CaptureHeader)) }
+    , max_segments_{ std::max<std::size_t>(max_segments, 1) }
+    , started_{ static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()) }
+    , segment_index_{ 0 }
+    , mapping_{ nullptr }
+    , used_{ 0 }
+#ifdef _WIN32
+    , file_{ INVALID_HANDLE_VALUE }
+    , file_mapping_{ nullptr }
+#else
+    , fd_{ -1 }
+#endif
+    , dropped_{ 0 }
+{
+    std::error_code ec{};
+    std::filesystem::create_directories(directory_, ec);
+    if (ec) {
+        spdlog::error("Failed to create the capture directory \"{}\": {}", directory_.string(), ec.message());
+    }
+}
+
+PacketCapture::~PacketCapture()
+{
+    close_segment();
+
+    if (dropped_ != 0) {
+        spdlog::warn("Capture \"{}\" dropped {} packets", name_, dropped_);
+    }
+}
+
+void PacketCapture::write(
+    const EventFrom from,
+    const uint32_t session,
+    const enet_uint8 channel,
+    const enet_uint32 flags,
+    const std::span<const std::byte> data
+)
+{
+    write(from, session, channel, flags, data, std::chrono::system_clock::now(), data.size());
+}
+
+void PacketCapture::write(
+    const EventFrom from,
+    const uint32_t session,
+    const enet_uint8 channel,
+    const enet_uint32 flags,
+    const std::span<const std::byte> data,
+    const std::chrono::system_clock::time_point time,
+    const std::size_t original_size
+)
+{
+    const std::size_t captured_size{ sizeof(CaptureHeader) + data.size() };
+    const std::size_t block_size{ get_record_size(data.size()) };
+    if (file_header_size + block_size > segment_size_) {
+        dropped_++;
+        return;
+    }
+
+    if (!mapping_ || used_ + block_size > segment_size_) {
+        close_segment();
+        if (!open_segment()) {
+            dropped_++;
+            return;
+        }
+    }
+
+    CaptureHeader header{ 1, static_cast<uint8_t>(from), channel, 0, flags, 0, session };
+    if (data.size() >= sizeof(packet::NetMessageType)) {
+        std::memcpy(&header.message_type, data.data(), sizeof(packet::NetMessageType));
+
+        // The packet type is the first field of the GameUpdatePacket.
+        if (header.message_type == packet::NET_MESSAGE_GAME_PACKET && data.size() > sizeof(packet::NetMessageType)) {
+            header.packet_type = static_cast<uint8_t>(data[sizeof(packet::NetMessageType)]);
+        }
+    }
+
+    const auto timestamp{
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count())
+    };
+
+    std::byte* out{ mapping_ + used_ };
+    out = put(out, enhanced_packet_block);
+    out = put(out, static_cast<uint32_t>(block_size));
+    out = put(out, uint32_t{ 0 }); // Interface
+    out = put(out, static_cast<uint32_t>(timestamp >> 32));
+    out = put(out, static_cast<uint32_t>(timestamp));
+    out = put(out, static_cast<uint32_t>(captured_size));
+    out = put(out, static_cast<uint32_t>(sizeof(CaptureHeader) + std::max(original_size, data.size())));
+    out = put(out, header);
+    std::memcpy(out, data.data(), data.size());
+    out += data.size();
+    std::memset(out, 0, pad4(captured_size) - captured_size);
+    out += pad4(captured_size) - captured_size;
+    put(out, static_cast<uint32_t>(block_size));
+
+    used_ += block_size;
+}
+
+std::size_t PacketCapture::get_file_header_size()
+{
+    return file_header_size;
+}
+
+std::size_t PacketCapture::get_record_size(const std::size_t data_size)
+{
+    return record_overhead + pad4(sizeof(CaptureHeader) + data_size);
+}
+
+bool PacketCapture::open_segment()
+{
+    const std::filesystem::path path{ directory_ / fmt::format("{}-{}-{}.pcapng", name_, started_, segment_index_++) };
+
+#ifdef _WIN32
+    file_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        spdlog::error("Failed to create the capture file \"{}\"", path.string());
+        return false;
+    }
+
+    const auto size{ static_cast<ULONGLONG>(segment_size_) };
+    file_mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    mapping_ = file_mapping_ ? static_cast<std::byte*>(MapViewOfFile(file_mapping_, FILE_MAP_WRITE, 0, 0, segment_size_)) : nullptr;
+#else
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        spdlog::error("Failed to create the capture file \"{}\"", path.string());
+        return false;
+    }
+
+    // Reserve the blocks up front, so a full disk fails here rather than with
+    // SIGBUS on a later write through the mapping.
+#ifdef __linux__
+    const bool reserved{ posix_fallocate(fd_, 0, static_cast<off_t>(segment_size_)) == 0 };
+#else
+    const bool reserved{ ftruncate(fd_, static_cast<off_t>(segment_size_)) == 0 };
+#endif
+
+    if (reserved) {
+        void* mapping{ mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0) };
+        mapping_ = mapping != MAP_FAILED ? static_cast<std::byte*>(mapping) : nullptr;
+    }
+#endif
+
+    if (!mapping_) {
+        spdlog::error("Failed to map the capture file \"{}\"", path.string());
+        close_segment();
+        std::error_code ec{};
+        std::filesystem::remove(path, ec);
+        return false;
+    }
+
+    std::byte* out{ mapping_ };
+    out = put(out, section_header_block);
+    out = put(out, uint32_t{ 28 });
+    out = put(out, uint32_t{ 0x1A2B3C4D }); // Byte-order magic
+    out = put(out, uint16_t{ 1 });
+    out = put(out, uint16_t{ 0 });
+    out = put(out, int64_t{ -1 }); // Section length not known in advance
+    out = put(out, uint32_t{ 28 });
+
+    out = put(out, interface_description_block);
+    out = put(out, uint32_t{ 20 });
+    out = put(out, linktype_user0);
+    out = put(out, uint16_t{ 0 });
+    out = put(out, uint32_t{ 0 }); // No snapshot length limit
+    put(out, uint32_t{ 20 });
+
+    used_ = file_header_size;
+
+    segments_.push_back(path);
+    while (segments_.size() > max_segments_) {
+        std::error_code ec{};
+        std::filesystem::remove(segments_.front(), ec);
+        segments_.pop_front();
+    }
+
+    return true;
+}
+
+void PacketCapture::close_segment()
+{
+#ifdef _WIN32
+    if (mapping_) {
+        UnmapViewOfFile(mapping_);
+    }
+
+    if (file_mapping_) {
+        CloseHandle(file_mapping_);
+        file_mapping_ = nullptr;
+    }
+
+    if (file_ != INVALID_HANDLE_VALUE) {
+        // Trim the preallocated tail so readers stop at the last record.
+        LARGE_INTEGER size{};
+        size.QuadPart = static_cast<LONGLONG>(used_);
+        SetFilePointerEx(file_, size, nullptr, FILE_BEGIN);
+        SetEndOfFile(file_);
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mapping_) {
+        munmap(mapping_, segment_size_);
+    }
+
+    if (fd_ != -1) {
+        // Trim the preallocated tail so readers stop at the last record.
+        std::ignore = ftruncate(fd_, static_cast<off_t>(used_));
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+
+    mapping_ = nullptr;
+    used_ = 0;
+}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <enet/enet.h>
+
+#include "core.hpp"
+
+namespace core {
+/**
+ * @brief Writes every packet one host receives to rotating pcapng files.
+ *
+ * Each record is an Enhanced Packet Block on a LINKTYPE_USER0 interface: a
+ * CaptureHeader followed by the ENet payload as received. Segment files are
+ * preallocated and memory-mapped, so a record costs one memcpy of the payload;
+ * a full segment is trimmed to its used size and the next one is opened, and
+ * only the newest max_segments files are kept.
+ *
+ * Not thread-safe; every host writes its own files from its own thread, and
+ * tools like mergecap can interleave them again by timestamp.
+ */
+class PacketCapture {
+public:
+#pragma pack(push, 1)
+    // Precedes every payload in the capture.
+    struct CaptureHeader {
+        uint8_t version;
+        uint8_t from; // EventFrom
+        uint8_t channel;
+        uint8_t packet_type; // PacketType for game packets, 0 otherwise
+        uint32_t flags; // ENetPacket::flags
+        uint32_t message_type; // NetMessageType, 0 if the payload is too short
+        uint32_t session;
+    };
+#pragma pack(pop)
+
+    /**
+     * @param directory Where the segment files go, created if needed.
+     * @param name Prefix of the segment file names.
+     * @param segment_size Size of one segment file in bytes.
+     * @param max_segments Segment files kept on disk before the oldest is deleted.
+     */
+    PacketCapture(std::filesystem::path directory, std::string name, std::size_t segment_size, std::size_t max_segments);
+    ~PacketCapture();
+
+    PacketCapture(const PacketCapture&) = delete;
+    PacketCapture& operator=(const PacketCapture&) = delete;
+
+    void write(EventFrom from, uint32_t session, enet_uint8 channel, enet_uint32 flags, std::span<const std::byte> data);
+    // For packets recorded earlier; data may be cut short of original_size.
+    void write(
+        EventFrom from,
+        uint32_t session,
+        enet_uint8 channel,
+        enet_uint32 flags,
+        std::span<const std::byte> data,
+        std::chrono::system_clock::time_point time,
+        std::size_t original_size
+    );
+
+    [[nodiscard]] uint64_t get_dropped() const { return dropped_; }
+
+    // Bytes a segment needs for its headers, and for one record of data_size payload bytes.
+    [[nodiscard]] static std::size_t get_file_header_size();
+    [[nodiscard]] static std::size_t get_record_size(std::size_t data_size);
+
+private:
+    bool open_segment();
+    void close_segment();
+
+    std::filesystem::path directory_;
+    std::string name_;
+    std::size_t segment_size_;
+    std::size_t max_segments_;
+
+    std::deque<std::filesystem::path> segments_;
+    // Unix time of the first segment, so a restart does not overwrite the last run.
+    uint64_t started_;
+    uint64_t segment_index_;
+
+    std::byte* mapping_;
+    std::size_t used_;
+#ifdef _WIN32
+    void* file_;
+    void* file_mapping_;
+#else
+    int fd_;
+#endif
+
+    // Records larger than a whole segment, or lost while no segment could be opened.
+    uint64_t dropped_;
+};
+}
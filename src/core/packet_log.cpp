@@ -0,0 +1,240 @@
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <magic_enum/magic_enum.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/bin_to_hex.h>
+
+#include "packet_log.hpp"
+#include "../packet/packet_types.hpp"
+#include "../packet/variant_view.hpp"
+#include "../utils/text_parse.hpp"
+
+namespace core {
+namespace {
+// "key|value|value", as TextParse::get_key_values() would give it.
+std::string get_key_value(const TextParseView& text_parse, const std::size_t field)
+{
+    std::string key_value{ text_parse.get_key(field) };
+    for (std::size_t i{ 0 }; i < text_parse.get_value_count(field); i++) {
+        key_value += '|';
+        key_value += text_parse.get_value(field, i);
+    }
+
+    return key_value;
+}
+}
+
+std::atomic<PacketLog*> PacketLog::instance_{ nullptr };
+
+PacketLog::PacketLog(const bool async)
+    : async_{ async }
+    , tail_{ 0 }
+    , head_{ 0 }
+    , dropped_{ 0 }
+{
+    if (async_) {
+        slots_ = std::make_unique<Slot[]>(capacity);
+        for (std::size_t i{ 0 }; i < capacity; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        formatter_ = std::jthread{ [this](const std::stop_token& stop) { run(stop); } };
+    }
+
+    instance_.store(this, std::memory_order_release);
+}
+
+PacketLog::~PacketLog()
+{
+    instance_.store(nullptr, std::memory_order_release);
+
+    if (formatter_.joinable()) {
+        formatter_.request_stop();
+        formatter_.join();
+    }
+}
+
+void PacketLog::write(const PacketLogKind kind, const EventFrom from, const std::span<const std::byte> data)
+{
+    PacketLog* packet_log{ instance_.load(std::memory_order_acquire) };
+    if (!packet_log || !packet_log->async_) {
+        format(kind, from, data, data.size());
+        return;
+    }
+
+    if (!packet_log->try_push(kind, from, data)) {
+        packet_log->dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool PacketLog::try_push(const PacketLogKind kind, const EventFrom from, const std::span<const std::byte> data)
+{
+    // Bounded multi-producer queue: a producer claims a slot by advancing tail_,
+    // and the slot's sequence tells whether the formatter is done with it.
+    std::size_t position{ tail_.load(std::memory_order_relaxed) };
+    Slot* slot{};
+    while (true) {
+        slot = &slots_[position % capacity];
+
+        const std::size_t sequence{ slot->sequence.load(std::memory_order_acquire) };
+        const auto diff{ static_cast<std::ptrdiff_t>(sequence - position) };
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            position = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    const std::size_t size{ std::min(data.size(), max_record_size) };
+    slot->kind = kind;
+    slot->from = from;
+    slot->size = static_cast<uint32_t>(size);
+    slot->original_size = static_cast<uint32_t>(data.size());
+    std::memcpy(slot->data.data(), data.data(), size);
+
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void PacketLog::run(const std::stop_token& stop)
+{
+    uint64_t reported_dropped{ 0 };
+
+    while (!stop.stop_requested()) {
+        // Producers never signal, so an empty ring is polled at a relaxed pace.
+        if (drain() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+        }
+
+        if (const uint64_t dropped{ get_dropped() }; dropped != reported_dropped) {
+            spdlog::warn("Packet log ring overflowed, {} records dropped ({} in total)", dropped - reported_dropped, dropped);
+            reported_dropped = dropped;
+        }
+    }
+
+    drain();
+}
+
+std::size_t PacketLog::drain()
+{
+    std::size_t count{ 0 };
+    while (true) {
+        Slot& slot{ slots_[head_ % capacity] };
+        if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+            return count;
+        }
+
+        format(slot.kind, slot.from, std::span{ slot.data.data(), slot.size }, slot.original_size);
+
+        slot.sequence.store(head_ + capacity, std::memory_order_release);
+        head_++;
+        count++;
+    }
+}
+
+void PacketLog::format(
+    const PacketLogKind kind,
+    const EventFrom from,
+    const std::span<const std::byte> data,
+    const std::size_t original_size
+)
+{
+    const std::string_view direction{ from == EventFrom::FromClient ? "client" : "server" };
+    if (data.size() < original_size) {
+        spdlog::info("Packet log record from {} truncated to {} of {} bytes", direction, data.size(), original_size);
+    }
+
+    switch (kind) {
+    case PacketLogKind::Message: {
+        const TextParse text_parse{ std::string{ reinterpret_cast<const char*>(data.data()), data.size() } };
+
+        spdlog::info("Incoming message from {}:", direction);
+        for (const auto& key_value : text_parse.get_key_values()) {
+            spdlog::info("\t{}", key_value);
+        }
+
+        break;
+    }
+    case PacketLogKind::GameUpdatePacket: {
+        constexpr std::size_t header_end{ sizeof(packet::NetMessageType) + sizeof(packet::GameUpdatePacket) };
+
+        packet::GameUpdatePacket game_update_packet{};
+        std::span<const std::byte> ext_data{};
+        if (data.size() >= header_end) {
+            std::memcpy(&game_update_packet, data.data() + sizeof(packet::NetMessageType), sizeof(packet::GameUpdatePacket));
+            ext_data = data.subspan(header_end, std::min<std::size_t>(data.size() - header_end, game_update_packet.data_size));
+        }
+
+        spdlog::info(
+            "Incoming GameUpdatePacket {} ({}) from {}: {:p}\n  EXT({}/{})={:p}\n",
+            magic_enum::enum_name(game_update_packet.type),
+            magic_enum::enum_integer(game_update_packet.type),
+            direction,
+            spdlog::to_hex(data.begin(), data.end()),
+            game_update_packet.data_size,
+            ext_data.size(),
+            spdlog::to_hex(ext_data.begin(), ext_data.end())
+        );
+        break;
+    }
+    case PacketLogKind::Variant: {
+        const packet::VariantView variant{ data };
+        if (!variant.valid()) {
+            spdlog::warn("Failed to deserialize variant from {}", direction);
+            break;
+        }
+
+        spdlog::info("Incoming variant from {}:", direction);
+        for (std::size_t i{ 0 }; i < variant.size(); i++) {
+            switch (variant.get_type(i)) {
+            case packet::VariantType::FLOAT:
+                spdlog::info("\t[FLOAT]: {}", variant.get<float>(i));
+                break;
+            case packet::VariantType::STRING: {
+                const std::string_view string{ variant.get(i) };
+                const TextParseView text_parse{ string };
+                if (!text_parse.empty()) {
+                    if (text_parse.size() == 1) {
+                        spdlog::info("\t[STRING]: {}", get_key_value(text_parse, 0));
+                        break;
+                    }
+
+                    spdlog::info("\t[STRING]:");
+                    for (std::size_t field{ 0 }; field < text_parse.size(); field++) {
+                        spdlog::info("\t\t{}", get_key_value(text_parse, field));
+                    }
+
+                    break;
+                }
+
+                spdlog::info("\t[STRING]: {}", string);
+                break;
+            }
+            case packet::VariantType::VEC2: {
+                const glm::vec2 vec2{ variant.get<glm::vec2>(i) };
+                spdlog::info("\t[VEC2]: x: {}, y: {}", vec2.x, vec2.y);
+                break;
+            }
+            case packet::VariantType::UNSIGNED:
+                spdlog::info("\t[UNSIGNED]: {}", variant.get<uint32_t>(i));
+                break;
+            case packet::VariantType::SIGNED:
+                spdlog::info("\t[SIGNED]: {}", variant.get<int32_t>(i));
+                break;
+            default:
+                break;
+            }
+        }
+
+        break;
+    }
+    }
+}
+}
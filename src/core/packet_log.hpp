@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <thread>
+
+#include "core.hpp"
+
+namespace core {
+enum class PacketLogKind : uint8_t {
+    // The text of a message, without its message type and terminator
+    Message,
+    // A whole game packet, message type included
+    GameUpdatePacket,
+    // The extended data of a call function packet
+    Variant
+};
+
+/**
+ * @brief Packet dumps for the log.printMessage, log.printGameUpdatePacket and
+ * log.printVariant toggles.
+ *
+ * Without a running instance, or with log.async off, records are formatted and
+ * logged on the calling thread. With log.async on, the calling thread only copies
+ * the raw bytes into a lock-free ring; a background thread does the hex dumps,
+ * variant parsing and sink I/O. Records that do not fit in the ring are dropped
+ * and counted, and oversized records are truncated.
+ *
+ * One instance serves every shard; main owns it.
+ */
+class PacketLog {
+public:
+    explicit PacketLog(bool async);
+    ~PacketLog();
+
+    PacketLog(const PacketLog&) = delete;
+    PacketLog& operator=(const PacketLog&) = delete;
+
+    static void write(PacketLogKind kind, EventFrom from, std::span<const std::byte> data);
+
+    [[nodiscard]] uint64_t get_dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t capacity{ 512 };
+    static constexpr std::size_t max_record_size{ 8192 };
+
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        PacketLogKind kind;
+        EventFrom from;
+        uint32_t size;
+        uint32_t original_size;
+        std::array<std::byte, max_record_size> data;
+    };
+
+    bool try_push(PacketLogKind kind, EventFrom from, std::span<const std::byte> data);
+    void run(const std::stop_token& stop);
+    // Formats every record waiting in the ring, returns how many there were.
+    std::size_t drain();
+
+    static void format(PacketLogKind kind, EventFrom from, std::span<const std::byte> data, std::size_t original_size);
+
+    static std::atomic<PacketLog*> instance_;
+
+    bool async_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<std::size_t> tail_;
+    alignas(64) std::size_t head_;
+    std::atomic<uint64_t> dropped_;
+
+    std::jthread formatter_;
+};
+}
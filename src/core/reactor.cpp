@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#include "reactor.hpp"
+
+namespace core {
+Reactor::Reactor(ENetHost* server_host, ENetHost* client_host)
+    : server_host_{ server_host }
+    , client_host_{ client_host }
+    , epoll_fd_{ -1 }
+    , timer_fd_{ -1 }
+{
+#ifdef __linux__
+    if (!server_host_ || !client_host_) {
+        return;
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd_ == -1 || timer_fd_ == -1) {
+        spdlog::error("Failed to create the reactor epoll/timer descriptors");
+        if (timer_fd_ != -1) {
+            close(timer_fd_);
+        }
+
+        if (epoll_fd_ != -1) {
+            close(epoll_fd_);
+        }
+
+        epoll_fd_ = timer_fd_ = -1;
+        return;
+    }
+
+    for (const int fd : { server_host_->socket, client_host_->socket, timer_fd_ }) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            spdlog::error("Failed to register descriptor {} with the reactor", fd);
+        }
+    }
+#endif
+}
+
+Reactor::~Reactor()
+{
+#ifdef __linux__
+    if (timer_fd_ != -1) {
+        close(timer_fd_);
+    }
+
+    if (epoll_fd_ != -1) {
+        close(epoll_fd_);
+    }
+#endif
+}
+
+void Reactor::wait(const std::chrono::microseconds max_wait) const
+{
+#ifdef __linux__
+    const enet_uint32 now{ enet_time_get() };
+    const auto timeout{ std::min({
+        max_wait,
+        time_to_deadline(server_host_, now),
+        time_to_deadline(client_host_, now)
+    }) };
+
+    if (timeout <= std::chrono::microseconds::zero()) {
+        return;
+    }
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+    spec.it_value.tv_nsec = static_cast<long>(timeout.count() % 1000000 * 1000);
+    timerfd_settime(timer_fd_, 0, &spec, nullptr);
+
+    std::array<epoll_event, 3> events{};
+    const int count{ epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1) };
+
+    for (int i{ 0 }; i < count; i++) {
+        if (events[i].data.fd == timer_fd_) {
+            uint64_t expirations{ 0 };
+            std::ignore = read(timer_fd_, &expirations, sizeof(expirations));
+        }
+    }
+#else
+    std::ignore = max_wait;
+#endif
+}
+
+std::chrono::microseconds Reactor::time_to_deadline(const ENetHost* host, const enet_uint32 now)
+{
+    enet_uint32 deadline{ host->bandwidthThrottleEpoch + ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL };
+
+    for (const ENetPeer* peer{ host->peers }; peer < &host->peers[host->peerCount]; ++peer) {
+        if (peer->state == ENET_PEER_STATE_DISCONNECTED) {
+            continue;
+        }
+
+        // Zombies are turned into disconnect events on the next service call.
+        if (peer->state == ENET_PEER_STATE_ZOMBIE) {
+            return std::chrono::microseconds::zero();
+        }
+
+        // Commands held back by the reliable window; poll again shortly.
+        if (!enet_list_empty(&peer->outgoingCommands) || !enet_list_empty(&peer->outgoingSendReliableCommands)) {
+            deadline = ENET_TIME_LESS(now + 1, deadline) ? now + 1 : deadline;
+        }
+
+        if (!enet_list_empty(&peer->sentReliableCommands) && ENET_TIME_LESS(peer->nextTimeout, deadline)) {
+            deadline = peer->nextTimeout;
+        }
+
+        if (peer->state == ENET_PEER_STATE_CONNECTED) {
+            const enet_uint32 next_ping{ peer->lastReceiveTime + peer->pingInterval };
+            if (ENET_TIME_LESS(next_ping, deadline)) {
+                deadline = next_ping;
+            }
+        }
+    }
+
+    if (ENET_TIME_LESS_EQUAL(deadline, now)) {
+        return std::chrono::microseconds::zero();
+    }
+
+    return std::chrono::milliseconds{ static_cast<long long>(ENET_TIME_DIFFERENCE(deadline, now)) };
+}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <chrono>
+#include <enet/enet.h>
+#include <enet/time.h>
+
+namespace core {
+/**
+ * @brief Waits on both ENet hosts from a single epoll set.
+ *
+ * Both UDP sockets and a timerfd are registered. The timer is armed for the
+ * earliest ENet deadline (retransmit, ping, bandwidth throttle) or the caller's
+ * own deadline, whichever comes first, so a datagram is serviced the moment it
+ * arrives rather than after a fixed sleep.
+ *
+ * Only available on Linux; is_open() is false everywhere else.
+ */
+class Reactor {
+public:
+    Reactor(ENetHost* server_host, ENetHost* client_host);
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    [[nodiscard]] bool is_open() const { return epoll_fd_ != -1; }
+
+    // Block until a socket is readable, an ENet deadline passes or max_wait elapses.
+    void wait(std::chrono::microseconds max_wait) const;
+
+private:
+    // Time left until ENet needs host to be serviced even if nothing arrives.
+    [[nodiscard]] static std::chrono::microseconds time_to_deadline(const ENetHost* host, enet_uint32 now);
+
+    ENetHost* server_host_;
+    ENetHost* client_host_;
+    int epoll_fd_;
+    int timer_fd_;
+};
+}
@@ -0,0 +1,132 @@
+#include <ranges>
+
+#include "session.hpp"
+
+namespace core {
+std::shared_ptr<Session> SessionTable::create(std::shared_ptr<player::Player> downstream)
+{
+    std::scoped_lock lock{ mutex_ };
+
+    const uint32_t id{ next_id_++ };
+    auto session{ std::make_shared<Session>(id, std::move(downstream)) };
+    sessions_.emplace(id, session);
+
+    return session;
+}
+
+void SessionTable::remove(const uint32_t id)
+{
+    std::scoped_lock lock{ mutex_ };
+    sessions_.erase(id);
+}
+
+void SessionTable::release(Session& session)
+{
+    if (session.release_leg()) {
+        remove(session.get_id());
+    }
+}
+
+std::shared_ptr<Session> SessionTable::find(const uint32_t id) const
+{
+    std::scoped_lock lock{ mutex_ };
+
+    const auto it{ sessions_.find(id) };
+    return it != sessions_.end() ? it->second : nullptr;
+}
+
+std::vector<std::shared_ptr<Session>> SessionTable::get_sessions() const
+{
+    std::scoped_lock lock{ mutex_ };
+    const auto sessions{ std::views::values(sessions_) };
+    return { sessions.begin(), sessions.end() };
+}
+
+std::size_t SessionTable::size() const
+{
+    std::scoped_lock lock{ mutex_ };
+    return sessions_.size();
+}
+
+HoldResult Session::hold(ENetPacket* packet, const enet_uint8 channel)
+{
+    std::scoped_lock lock{ held_mutex_ };
+    if (!holding_) {
+        return HoldResult::Released;
+    }
+
+    if (held_.size() >= max_held) {
+        return HoldResult::Full;
+    }
+
+    held_.push_back({ { packet, &enet_packet_destroy }, channel });
+    return HoldResult::Held;
+}
+
+std::optional<std::vector<HeldPacket>> Session::release_held()
+{
+    std::scoped_lock lock{ held_mutex_ };
+    if (!holding_) {
+        return std::nullopt;
+    }
+
+    holding_ = false;
+    return std::move(held_);
+}
+
+void RedirectTable::push(RedirectTicket ticket, std::string address, const enet_uint16 port)
+{
+    const auto now{ std::chrono::steady_clock::now() };
+
+    std::scoped_lock lock{ mutex_ };
+    prune(now);
+    tickets_.insert_or_assign(std::move(ticket), Redirect{ std::move(address), port, now });
+}
+
+void RedirectTable::push(const enet_uint32 host, std::string address, const enet_uint16 port)
+{
+    const auto now{ std::chrono::steady_clock::now() };
+
+    std::scoped_lock lock{ mutex_ };
+    prune(now);
+    logins_.insert_or_assign(host, Redirect{ std::move(address), port, now });
+}
+
+std::optional<Redirect> RedirectTable::take(const RedirectTicket& ticket)
+{
+    std::scoped_lock lock{ mutex_ };
+
+    const auto it{ tickets_.find(ticket) };
+    if (it == tickets_.end()) {
+        return std::nullopt;
+    }
+
+    std::optional<Redirect> redirect{};
+    if (std::chrono::steady_clock::now() - it->second.issued <= lifetime) {
+        redirect = std::move(it->second);
+    }
+
+    tickets_.erase(it);
+    return redirect;
+}
+
+std::optional<Redirect> RedirectTable::find(const enet_uint32 host)
+{
+    std::scoped_lock lock{ mutex_ };
+
+    const auto it{ logins_.find(host) };
+    if (it == logins_.end() || std::chrono::steady_clock::now() - it->second.issued > lifetime) {
+        return std::nullopt;
+    }
+
+    return it->second;
+}
+
+// Tickets of game clients that never came back would otherwise pile up.
+void RedirectTable::prune(const std::chrono::steady_clock::time_point now)
+{
+    const auto expired{ [now](const auto& entry) { return now - entry.second.issued > lifetime; } };
+    std::erase_if(tickets_, expired);
+    std::erase_if(logins_, expired);
+}
+}
@@ -0,0 +1,191 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <enet/enet.h>
+
+#include "../player/player.hpp"
+
+namespace core {
+/**
+ * @brief Where the upstream leg of a session should connect to.
+ */
+struct Redirect {
+    std::string address;
+    enet_uint16 port;
+    std::chrono::steady_clock::time_point issued;
+};
+
+/**
+ * @brief What a game client sends back in its login after an OnSendToServer.
+ */
+struct RedirectTicket {
+    int32_t token;
+    int32_t user;
+    std::string uuid_token;
+
+    bool operator==(const RedirectTicket&) const = default;
+};
+
+struct RedirectTicketHash {
+    std::size_t operator()(const RedirectTicket& ticket) const noexcept
+    {
+        const std::size_t ids{ static_cast<std::size_t>(static_cast<uint32_t>(ticket.token)) << 32 | static_cast<uint32_t>(ticket.user) };
+        return std::hash<std::size_t>{}(ids) ^ std::hash<std::string_view>{}(ticket.uuid_token) * 31;
+    }
+};
+
+/**
+ * @brief A packet from the game client that arrived before the upstream was ready for it.
+ */
+struct HeldPacket {
+    std::unique_ptr<ENetPacket, decltype(&enet_packet_destroy)> packet;
+    enet_uint8 channel;
+};
+
+enum class HoldResult {
+    Held,
+    // Too much arrived before the upstream was ready; the packet was not taken.
+    Full,
+    // The upstream is ready; the packet was not taken and should be forwarded.
+    Released
+};
+
+/**
+ * @brief One game client and its own connection to the real server.
+ *
+ * The downstream leg is the game client connected to our server host, the
+ * upstream leg is the peer our client host opened for it. Both peers point back
+ * at the session through ENetPeer::data.
+ *
+ * Each leg holds a reference on the session; the session leaves the table once
+ * both legs are gone. The upstream reference is taken when the connection is
+ * queued, so a session outlives a connection attempt that is still in flight.
+ *
+ * The upstream is only connected once the game client logged in, since the
+ * login says where it should go. Until the real server greets the upstream,
+ * whatever the game client sends is held and then handed over in order.
+ */
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    Session(const uint32_t id, std::shared_ptr<player::Player> downstream)
+        : id_{ id }
+        , downstream_{ std::move(downstream) }
+        , legs_{ 1 }
+    {
+
+    }
+
+    [[nodiscard]] uint32_t get_id() const { return id_; }
+
+    [[nodiscard]] std::shared_ptr<player::Player> get_downstream() const { return downstream_.load(); }
+    [[nodiscard]] std::shared_ptr<player::Player> get_upstream() const { return upstream_.load(); }
+
+    void attach_upstream(std::shared_ptr<player::Player> upstream) { upstream_.store(std::move(upstream)); }
+    std::shared_ptr<player::Player> detach_downstream() { return downstream_.exchange(nullptr); }
+    std::shared_ptr<player::Player> detach_upstream() { return upstream_.exchange(nullptr); }
+
+    void acquire_leg() { legs_.fetch_add(1, std::memory_order_relaxed); }
+    // Returns true when the last leg was released and the session can be dropped.
+    [[nodiscard]] bool release_leg() { return legs_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    // Only touched by the thread servicing the server host.
+    [[nodiscard]] bool is_upstream_requested() const { return upstream_requested_; }
+    void set_upstream_requested() { upstream_requested_ = true; }
+
+    // Takes the packet only if the result is Held.
+    [[nodiscard]] HoldResult hold(ENetPacket* packet, enet_uint8 channel);
+    // Ends holding and hands over what was held, oldest first. Empty if it already ended.
+    [[nodiscard]] std::optional<std::vector<HeldPacket>> release_held();
+
+private:
+    uint32_t id_;
+
+    std::atomic<std::shared_ptr<player::Player>> downstream_;
+    std::atomic<std::shared_ptr<player::Player>> upstream_;
+    std::atomic<uint32_t> legs_;
+
+    // The game client waits for an answer to its login, so little arrives before the upstream is ready.
+    static constexpr std::size_t max_held{ 16 };
+
+    bool upstream_requested_{ false };
+    std::mutex held_mutex_;
+    bool holding_{ true };
+    std::vector<HeldPacket> held_;
+};
+
+// Events carry the session as a plain pointer; the alias keeps their
+// `const T&` getters from turning it into a pointer to const.
+using SessionPtr = Session*;
+
+/**
+ * @brief Every live session of one core.
+ *
+ * The table is only locked when sessions come and go; forwarding reaches the
+ * session through ENetPeer::data.
+ */
+class SessionTable {
+public:
+    SessionTable() = default;
+    SessionTable(const SessionTable&) = delete;
+    SessionTable& operator=(const SessionTable&) = delete;
+
+    std::shared_ptr<Session> create(std::shared_ptr<player::Player> downstream);
+    void remove(uint32_t id);
+    // Drops one leg's reference and removes the session once both are gone.
+    void release(Session& session);
+
+    [[nodiscard]] std::shared_ptr<Session> find(uint32_t id) const;
+    [[nodiscard]] std::vector<std::shared_ptr<Session>> get_sessions() const;
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    uint32_t next_id_{ 1 };
+    std::unordered_map<uint32_t, std::shared_ptr<Session>> sessions_;
+};
+
+/**
+ * @brief Redirects waiting for a game client to log in.
+ *
+ * Redirects are issued before the game client (re)connects, so there is no
+ * peer to attach them to yet. A sub-server switch is filed under the ticket
+ * from its OnSendToServer, which the game client repeats in its next login, so
+ * several game clients behind one address each get their own.
+ *
+ * The first login carries no ticket. It goes where server_data.php pointed the
+ * address it came from; that answer is the same for every game client, so a
+ * newer one simply replaces the older.
+ *
+ * Shared by every shard, since the connection may land on any of them.
+ */
+class RedirectTable {
+public:
+    RedirectTable() = default;
+    RedirectTable(const RedirectTable&) = delete;
+    RedirectTable& operator=(const RedirectTable&) = delete;
+
+    void push(RedirectTicket ticket, std::string address, enet_uint16 port);
+    void push(enet_uint32 host, std::string address, enet_uint16 port);
+
+    // Each ticket is good for one login.
+    [[nodiscard]] std::optional<Redirect> take(const RedirectTicket& ticket);
+    [[nodiscard]] std::optional<Redirect> find(enet_uint32 host);
+
+private:
+    // A game client that never showed up must not steer a later connection.
+    static constexpr std::chrono::seconds lifetime{ 60 };
+
+    void prune(std::chrono::steady_clock::time_point now);
+
+    std::mutex mutex_;
+    std::unordered_map<RedirectTicket, Redirect, RedirectTicketHash> tickets_;
+    std::unordered_map<enet_uint32, Redirect> logins_;
+};
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "shard_group.hpp"
+
+namespace core {
+ShardGroup::ShardGroup(Setup setup)
+    : setup_{ std::move(setup) }
+    , redirects_{ std::make_shared<RedirectTable>() }
+    , stopping_{ false }
+{
+
+}
+
+void ShardGroup::run()
+{
+    std::size_t shard_count{ std::max(config_.get<unsigned int>("core.shards"), 1u) };
+
+#ifndef __linux__
+    if (shard_count > 1) {
+        spdlog::warn("Sharding needs SO_REUSEPORT load balancing, which is Linux only; running a single shard");
+        shard_count = 1;
+    }
+#endif
+
+    if (shard_count > 1) {
+        spdlog::info("Running {} shards on port {}", shard_count, config_.get<unsigned int>("enet.port"));
+    }
+
+    // Every shard's copy of the config sees the reloads.
+    config_.watch();
+
+    std::vector<std::thread> workers{};
+    workers.reserve(shard_count - 1);
+
+    for (std::size_t shard{ 1 }; shard < shard_count; shard++) {
+        workers.emplace_back([this, shard, shard_count] {
+            try {
+                run_shard(shard, shard_count);
+            }
+            catch (const std::exception& ex) {
+                spdlog::error("Shard {} failed: {}", shard, ex.what());
+                stop();
+            }
+        });
+    }
+
+    const auto join{ [&workers] {
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    } };
+
+    try {
+        run_shard(0, shard_count);
+    }
+    catch (...) {
+        stop();
+        join();
+        throw;
+    }
+
+    // The first shard returning means the proxy is shutting down.
+    stop();
+    join();
+}
+
+void ShardGroup::stop()
+{
+    std::scoped_lock lock{ mutex_ };
+
+    stopping_ = true;
+    for (Core* core : cores_) {
+        core->stop();
+    }
+}
+
+void ShardGroup::run_shard(const std::size_t shard, const std::size_t shard_count)
+{
+    if (config_.get<bool>("core.pinShards")) {
+        pin_to_cpu(shard % std::max(std::thread::hardware_concurrency(), 1u));
+    }
+
+    Core core{ config_, redirects_, shard, shard_count };
+
+    {
+        std::scoped_lock lock{ mutex_ };
+        if (stopping_) {
+            return;
+        }
+
+        cores_.push_back(&core);
+    }
+
+    const auto unregister{ [this, &core] {
+        std::scoped_lock lock{ mutex_ };
+        std::erase(cores_, &core);
+    } };
+
+    try {
+        setup_(core);
+        core.run();
+    }
+    catch (...) {
+        unregister();
+        throw;
+    }
+
+    unregister();
+}
+
+void ShardGroup::pin_to_cpu(const std::size_t cpu)
+{
+#ifdef __linux__
+    cpu_set_t set{};
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        spdlog::warn("Failed to pin a shard to CPU {}", cpu);
+        return;
+    }
+#elif defined(_WIN32)
+    if (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << cpu) == 0) {
+        spdlog::warn("Failed to pin a shard to CPU {}", cpu);
+        return;
+    }
+#else
+    spdlog::warn("Pinning shards is not supported on this platform");
+    return;
+#endif
+
+    spdlog::info("Pinned a shard to CPU {}", cpu);
+}
+}
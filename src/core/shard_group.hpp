@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "config.hpp"
+#include "core.hpp"
+
+namespace core {
+/**
+ * @brief Runs "core.shards" independent cores, one per thread.
+ *
+ * Every shard owns a listening host bound to enet.port with SO_REUSEPORT, its
+ * own upstream host, sessions and extension instances. The kernel keeps each
+ * game client on the shard that accepted it. Only the configuration and the
+ * redirect table are shared.
+ *
+ * Shards always run the "reactor" model, whatever core.ioModel says: both
+ * hosts are serviced by the shard's one thread, so the packet path never
+ * crosses threads and core.pinShards pins all of it.
+ *
+ * With a single shard the core runs on the calling thread, exactly as before.
+ */
+class ShardGroup {
+public:
+    // Called on the shard's own thread to add its extensions before it runs.
+    using Setup = std::function<void(Core&)>;
+
+    explicit ShardGroup(Setup setup);
+
+    // Blocks until every shard stopped.
+    void run();
+    void stop();
+
+    [[nodiscard]] const Config& get_config() const { return config_; }
+
+private:
+    void run_shard(std::size_t shard, std::size_t shard_count);
+
+    static void pin_to_cpu(std::size_t cpu);
+
+    Setup setup_;
+    Config config_;
+    std::shared_ptr<RedirectTable> redirects_;
+
+    std::mutex mutex_;
+    std::vector<Core*> cores_;
+    bool stopping_;
+};
+}
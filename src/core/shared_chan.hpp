@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <windows.h>
+#include <span>
 #include <string>
 #include <atomic>
 #include <cassert>
@@ -231,6 +232,18 @@ public:
         );
     }
 
+    // send to a named channel straight from a packet buffer
+    bool send_to(const std::string& name,
+                 std::span<const std::byte> data)
+    {
+        auto it = channels_.find(name);
+        if (it == channels_.end()) return false;
+        return it->second->send(
+            reinterpret_cast<const uint8_t*>(data.data()),
+            static_cast<uint32_t>(data.size())
+        );
+    }
+
     bool send_to(const std::string& name)
     {
         // just forward with an empty uint8_t vector
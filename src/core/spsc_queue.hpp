@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+
+namespace core {
+/**
+ * @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+ *
+ * Each side keeps a cached copy of the other side's index, so the shared
+ * atomics are only re-read when the queue looks full (producer) or empty
+ * (consumer).
+ *
+ * @tparam T The element type, copied in and out.
+ * @tparam Capacity The number of slots, must be a power of two.
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+
+public:
+    [[nodiscard]] bool try_push(const T& value)
+    {
+        const std::size_t tail{ tail_.load(std::memory_order_relaxed) };
+        if (tail - head_cache_ == Capacity) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == Capacity) {
+                return false;
+            }
+        }
+
+        buffer_[tail & (Capacity - 1)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] bool try_pop(T& value)
+    {
+        const std::size_t head{ head_.load(std::memory_order_relaxed) };
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return false;
+            }
+        }
+
+        value = buffer_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when read from a third thread.
+    [[nodiscard]] std::size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    static constexpr std::size_t cache_line{ 64 };
+
+    // Consumer side
+    alignas(cache_line) std::atomic<std::size_t> head_{ 0 };
+    std::size_t tail_cache_{ 0 };
+
+    // Producer side
+    alignas(cache_line) std::atomic<std::size_t> tail_{ 0 };
+    std::size_t head_cache_{ 0 };
+
+    alignas(cache_line) std::array<T, Capacity> buffer_{};
+};
+}
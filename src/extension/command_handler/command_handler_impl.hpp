@@ -9,6 +9,7 @@
 #include "../../utils/text_parse.hpp"
 #include "../parser/parser.hpp"
 #include "command_handler.hpp"
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -246,6 +247,44 @@ namespace extension::command_handler
     int32_t block_auto_id = -1;
     bool auto_break = false;
     std::mutex auto_mutex;
+    // The session commands and automation act on: whoever typed a command
+    // last. Everything above belongs to it; other sessions' traffic is ignored.
+    std::atomic<std::shared_ptr<core::Session>> session_{};
+
+    std::shared_ptr<player::Player> to_client() const
+    {
+      const auto session = session_.load();
+      return session ? session->get_downstream() : nullptr;
+    }
+
+    std::shared_ptr<player::Player> to_server() const
+    {
+      const auto session = session_.load();
+      return session ? session->get_upstream() : nullptr;
+    }
+
+    bool is_bound(const core::Session *session) const
+    {
+      return session_.load().get() == session;
+    }
+
+    void bind_session(core::Session *session)
+    {
+      if (is_bound(session))
+      {
+        return;
+      }
+
+      session_.store(session->shared_from_this());
+
+      // What was tracked and running belonged to the previous session. The
+      // automation threads may hold auto_mutex for seconds, so the recorded
+      // blocks are left for the next /rec to replace.
+      auto_fish = false;
+      auto_break = false;
+      record_block = false;
+      world.reset();
+    }
 
     void console_log(const char *fmt, ...)
     {
@@ -271,7 +310,10 @@ namespace extension::command_handler
         spdlog::info("\t{}", key_value);
       }
 
-      core_->get_server()->get_player()->send_packet(s.get_data());
+      if (const auto player = to_client())
+      {
+        player->send_packet(s.get_data());
+      }
     }
 
     void send_tile_change_request(int px, int py, int x, int y, uint32_t id)
@@ -300,7 +342,13 @@ namespace extension::command_handler
 
         spdlog::info("Send tile change request: {} {} {} {} {}", pkt.vec_x, pkt.vec_y, pkt.int_x, pkt.int_y, pkt.value);
 
-        core_->get_client()->get_player()->send_packet(s.get_data());
+        const auto player = to_server();
+        if (!player)
+        {
+          return;
+        }
+
+        player->send_packet(s.get_data());
 
         pkt.flags.on_placed = true;
         if (player_tile_x > x)
@@ -315,7 +363,7 @@ namespace extension::command_handler
         write_tank(pkt, s2);
         s2.write('\x00');
 
-        core_->get_client()->get_player()->send_packet(s2.get_data());
+        player->send_packet(s2.get_data());
       }
     }
 
@@ -326,7 +374,10 @@ namespace extension::command_handler
       pkt.x = x;
       pkt.y = y;
 
-      packet::PacketHelper::send(pkt, *core_->get_server()->get_player());
+      if (const auto player = to_client())
+      {
+        packet::PacketHelper::send(pkt, *player);
+      }
     }
 
   public:
@@ -353,7 +404,9 @@ namespace extension::command_handler
           last_event = time(NULL);
         }
         if (time(NULL) - last_event > 30) {
-          sendThrowPacket(*core_->get_client()->get_player());
+          if (const auto player = to_server()) {
+            sendThrowPacket(*player);
+          }
           last_event = time(NULL);
         }
         Sleep(500);
@@ -413,11 +466,17 @@ namespace extension::command_handler
       core_->get_event_dispatcher().prependListener(
           core::EventType::Message, [this](const core::EventMessage &event)
           {
-          TextParse textParse(event.get_message().get_raw(), "|");
-
-          std::string command = textParse.get("text");
+          // Straight from the received message; no owning copy is built.
+          std::string command{event.get_view().get("text")};
           std::cout << command << "\n";
 
+          if (event.from != core::EventFrom::FromClient || !command.starts_with('/')) {
+            return;
+          }
+
+          // Whoever types a command is the player at the keyboard.
+          bind_session(event.get_session());
+
           if (command.rfind("/fd") == 0) {
             fast_drop = !fast_drop;
             console_log("fd is now %s", fast_drop ? "on" : "off");
@@ -461,9 +520,23 @@ namespace extension::command_handler
             event.canceled = true;
           } else if (command.rfind("/ft") == 0) {
             auto_fish = true;
-            sendThrowPacket(*core_->get_client()->get_player());
+            if (const auto player = to_server()) {
+              sendThrowPacket(*player);
+            }
             last_event = time(NULL);
             event.canceled = true;
+          } else if (command.rfind("/dump") == 0) {
+            // Each host dumps its own recorder from its own thread.
+            const uint32_t session_id = event.get_session()->get_id();
+            for (core::FlightRecorder *recorder :
+                 {core_->get_server()->get_flight_recorder(),
+                  core_->get_client()->get_flight_recorder()}) {
+              if (recorder) {
+                recorder->request_dump(session_id);
+              }
+            }
+            console_log("Dumping the flight recorder of session #%u", session_id);
+            event.canceled = true;
           }  else if (command.rfind("/test") == 0) {
             send_tile_change_request(floorf(world.my_x), floorf(world.my_y), world.my_x + 1, world.my_y, 18);
             event.canceled = true;
@@ -479,14 +552,12 @@ namespace extension::command_handler
             }
             event.canceled = true;
           } });
-      core_->get_event_dispatcher().prependListener(
-          core::EventType::Packet, [this](const core::EventPacket &pkt)
+      auto &packets{core_->get_packet_dispatcher()};
+      packets.prepend_listener(
+          packet::PacketType::PACKET_SEND_MAP_DATA, core::EventFrom::FromServer,
+          [this](const core::EventPacket &pkt)
           {
-          const packet::GameUpdatePacket &game_pkt = pkt.get_packet();
-          if (game_pkt.type == packet::PacketType::PACKET_SEND_MAP_DATA &&
-              pkt.from == core::EventFrom::FromServer) {
-            ByteStream stream{(std::byte *)(pkt.get_data().data()),
-                              pkt.get_data().size()};
+            ByteStreamView stream{pkt.get_data()};
 
             stream.skip(66);
             std::string world_name;
@@ -510,10 +581,29 @@ namespace extension::command_handler
             // Windows
             // CreateSymbolicLinkA(format_string("%s\\.gtworlds\\current",
             // home.c_str()).c_str(), path.c_str(), 0);
-          } else if (game_pkt.type == packet::PacketType::PACKET_GONE_FISHIN) {
+          });
+      packets.prepend_listener(
+          packet::PacketType::PACKET_GONE_FISHIN, core::EventFrom::FromAny,
+          [this](const core::EventPacket &pkt)
+          {
+            if (!is_bound(pkt.get_session()))
+            {
+              return;
+            }
+
             // TODO: check if the event is targeted to myself
             chan.send_to("FishThrowOrReel");
-          } else if (game_pkt.type == packet::PacketType::PACKET_TILE_CHANGE_REQUEST && pkt.from == core::EventFrom::FromServer) {
+          });
+      packets.prepend_listener(
+          packet::PacketType::PACKET_TILE_CHANGE_REQUEST, core::EventFrom::FromServer,
+          [this](const core::EventPacket &pkt)
+          {
+            if (!is_bound(pkt.get_session()))
+            {
+              return;
+            }
+
+            const packet::GameUpdatePacket &game_pkt = pkt.get_packet();
             auto it = std::find_if(blocks.begin(), blocks.end(), [game_pkt](const Block &b) {
               return b.x == game_pkt.int_x && b.y == game_pkt.int_y;
             });
@@ -524,10 +614,30 @@ namespace extension::command_handler
                 it[0].destroyed = false;
               }
             }
-          } else if (game_pkt.type == packet::PacketType::PACKET_SET_CHARACTER_STATE) {
+          });
+      packets.prepend_listener(
+          packet::PacketType::PACKET_SET_CHARACTER_STATE, core::EventFrom::FromAny,
+          [this](const core::EventPacket &pkt)
+          {
+            if (!is_bound(pkt.get_session()))
+            {
+              return;
+            }
+
+            const packet::GameUpdatePacket &game_pkt = pkt.get_packet();
             world.build_range = game_pkt.jump_count - 126;
             world.punch_range = game_pkt.animation_type - 126;
-          } else if (game_pkt.type == packet::PacketType::PACKET_STATE && pkt.from == core::EventFrom::FromClient) {
+          });
+      packets.prepend_listener(
+          packet::PacketType::PACKET_STATE, core::EventFrom::FromClient,
+          [this](const core::EventPacket &pkt)
+          {
+            if (!is_bound(pkt.get_session()))
+            {
+              return;
+            }
+
+            const packet::GameUpdatePacket &game_pkt = pkt.get_packet();
             world.my_x = game_pkt.vec_x;
             world.my_y = game_pkt.vec_y;
 
@@ -545,217 +655,266 @@ namespace extension::command_handler
               console_log("recorded block at (%d, %d)", game_pkt.int_x, game_pkt.int_y);
             }
             chan.send_to("PlayerUpdate", pkt.get_data());
-          } else if (game_pkt.type ==
-                     packet::PacketType::PACKET_SEND_INVENTORY_STATE) {
-            chan.send_to("SendInventory", pkt.get_ext_data());
-          } else if (game_pkt.type == packet::PacketType::PACKET_ITEM_CHANGE_OBJECT) {
-            chan.send_to("ItemChange", pkt.get_data());
-          } else if (game_pkt.type == packet::PacketType::PACKET_MODIFY_ITEM_INVENTORY) {
-            chan.send_to("ModifyInventory", pkt.get_data());
-          } });
+          });
+      packets.prepend_listener(
+          packet::PacketType::PACKET_SEND_INVENTORY_STATE, core::EventFrom::FromAny,
+          [this](const core::EventPacket &pkt)
+          {
+            if (is_bound(pkt.get_session()))
+            {
+              chan.send_to("SendInventory", pkt.get_ext_data());
+            }
+          });
+      packets.prepend_listener(
+          packet::PacketType::PACKET_ITEM_CHANGE_OBJECT, core::EventFrom::FromAny,
+          [this](const core::EventPacket &pkt)
+          {
+            if (is_bound(pkt.get_session()))
+            {
+              chan.send_to("ItemChange", pkt.get_data());
+            }
+          });
+      packets.prepend_listener(
+          packet::PacketType::PACKET_MODIFY_ITEM_INVENTORY, core::EventFrom::FromAny,
+          [this](const core::EventPacket &pkt)
+          {
+            if (is_bound(pkt.get_session()))
+            {
+              chan.send_to("ModifyInventory", pkt.get_data());
+            }
+          });
 
       auto ext{core_->query_extension<IParserExtension>()};
-      ext->get_event_dispatcher().appendListener(
-          IParserExtension::EventType::CallFunction,
+      ext->append_call_function_listener(
+          "OnConsoleMessage",
           [&](const IParserExtension::EventCallFunction &evt)
           {
-            if (evt.from != core::EventFrom::FromServer)
+            if (!is_bound(evt.get_session()))
             {
               return;
             }
 
-            const packet::Variant evt_variant{evt.get_args()};
-            std::string fn_name = evt.get_function_name();
-            if (fn_name == "OnConsoleMessage")
+            std::string_view msg = evt.get_args().get(1);
+            if (msg == "The hole in the ice froze over!" ||
+                msg == "The uranium reformed!")
             {
-              std::string msg = evt_variant.get(1);
-              if (msg == "The hole in the ice froze over!" ||
-                  msg == "The uranium reformed!")
+              chan.send_to("FishBlockChangeToSolid");
+              if (auto_fish)
               {
-                chan.send_to("FishBlockChangeToSolid");
-                if (auto_fish)
-                {
-                  std::thread([&]()
-                              {
-                  Sleep(1000);
-                  sendDetoPacket(*core_->get_client()->get_player());
-                  Sleep(700);
-                  sendThrowPacket(*core_->get_client()->get_player());
-                  last_event = time(NULL); })
-                      .detach();
-                }
+                std::thread([&]()
+                            {
+                Sleep(1000);
+                if (const auto player = to_server()) sendDetoPacket(*player);
+                Sleep(700);
+                if (const auto player = to_server()) sendThrowPacket(*player);
+                last_event = time(NULL); })
+                    .detach();
               }
             }
-            else if (fn_name == "OnPlayPositioned")
+          });
+      ext->append_call_function_listener(
+          "OnPlayPositioned",
+          [&](const IParserExtension::EventCallFunction &evt)
+          {
+            if (!is_bound(evt.get_session()))
             {
-              std::string file = evt_variant.get(1);
+              return;
+            }
+
+            std::string_view file = evt.get_args().get(1);
 
-              if (file == "audio/splash.wav")
+            if (file == "audio/splash.wav")
+            {
+              chan.send_to("FishCaught");
+              if (auto_fish)
               {
-                chan.send_to("FishCaught");
-                if (auto_fish)
-                {
-                  std::thread([&]()
-                              {
-                  Sleep(500);
-                  sendReelPacket(*core_->get_client()->get_player());
-                  Sleep(700);
-                  sendThrowPacket(*core_->get_client()->get_player());
-                  last_event = time(NULL); })
-                      .detach();
-                }
+                std::thread([&]()
+                            {
+                Sleep(500);
+                if (const auto player = to_server()) sendReelPacket(*player);
+                Sleep(700);
+                if (const auto player = to_server()) sendThrowPacket(*player);
+                last_event = time(NULL); })
+                    .detach();
               }
             }
-            else if (fn_name == "OnTalkBubble")
+          });
+      ext->append_call_function_listener(
+          "OnTalkBubble",
+          [&](const IParserExtension::EventCallFunction &evt)
+          {
+            if (!is_bound(evt.get_session()))
             {
-              std::string msg = evt_variant.get(2);
-              if (msg == "You need to drill the ice before you can fish!" ||
-                  msg ==
-                      "You need to detonate the uranium before you can fish!")
-              {
-                chan.send_to("FishObstructed");
-              }
-              else if (msg == "You can't fish here, find an emptier spot!")
-              {
-                chan.send_to("FishFull");
-              }
+              return;
             }
-            else if (fn_name == "OnDialogRequest")
+
+            std::string_view msg = evt.get_args().get(2);
+            if (msg == "You need to drill the ice before you can fish!" ||
+                msg ==
+                    "You need to detonate the uranium before you can fish!")
             {
-              std::string req = evt_variant.get(1);
-              if (req.contains("How many to drop") && fast_drop)
+              chan.send_to("FishObstructed");
+            }
+            else if (msg == "You can't fish here, find an emptier spot!")
+            {
+              chan.send_to("FishFull");
+            }
+          });
+      ext->append_call_function_listener(
+          "OnDialogRequest",
+          [&](const IParserExtension::EventCallFunction &evt)
+          {
+            if (!is_bound(evt.get_session()))
+            {
+              return;
+            }
+
+            std::string req = evt.get_args().get<std::string>(1);
+            if (req.contains("How many to drop") && fast_drop)
+            {
+              TextParse req_{req};
+              std::string itemID = req_.get("embed_data", 1);
+              std::string count = req_.get("add_text_input", 1);
+
+              TextParse cmd_{};
+              cmd_.add("itemID", {itemID});
+              cmd_.add("count", {count});
+              cmd_.add("dialog_name", {"drop_item"});
+              cmd_.add("action", {"dialog_return"});
+
+              std::string cmd = cmd_.get_raw();
+
+              ByteStream s{};
+              s.write<uint32_t>(2);
+              s.write_data(cmd.c_str(), cmd.length() + 1);
+
+              std::vector<std::byte> b{};
+              s.read_vector(b, 4 + cmd.length() + 1);
+              Sleep(100 + randrange(-50, 50));
+              if (const auto player = to_server())
               {
-                TextParse req_{req};
-                std::string itemID = req_.get("embed_data", 1);
-                std::string count = req_.get("add_text_input", 1);
-
-                TextParse cmd_{};
-                cmd_.add("itemID", {itemID});
-                cmd_.add("count", {count});
-                cmd_.add("dialog_name", {"drop_item"});
-                cmd_.add("action", {"dialog_return"});
-
-                std::string cmd = cmd_.get_raw();
-
-                ByteStream s{};
-                s.write<uint32_t>(2);
-                s.write_data(cmd.c_str(), cmd.length() + 1);
-
-                std::vector<std::byte> b{};
-                s.read_vector(b, 4 + cmd.length() + 1);
-                Sleep(100 + randrange(-50, 50));
-                std::ignore =
-                    core_->get_client()->get_player()->send_packet(b, 0);
-                evt.canceled = true;
+                std::ignore = player->send_packet(b, 0);
               }
-              else if (req.contains("How many to `4destroy``") && fast_recycle)
+              evt.canceled = true;
+            }
+            else if (req.contains("How many to `4destroy``") && fast_recycle)
+            {
+              TextParse req_{req};
+              std::string itemID = req_.get("embed_data", 1);
+              // std::string count = req_.get("add_text_input", 1);
+
+              TextParse cmd_{};
+              cmd_.add("itemID", {itemID});
+              cmd_.add("count", {"199"});
+              cmd_.add("dialog_name", {"trash_item"});
+              cmd_.add("action", {"dialog_return"});
+
+              std::string cmd = cmd_.get_raw();
+
+              ByteStream s{};
+              s.write<uint32_t>(2);
+              s.write_data(cmd.c_str(), cmd.length() + 1);
+
+              std::vector<std::byte> b{};
+              s.read_vector(b, 4 + cmd.length() + 1);
+              Sleep(100 + randrange(-50, 50));
+              if (const auto player = to_server())
               {
-                TextParse req_{req};
-                std::string itemID = req_.get("embed_data", 1);
-                // std::string count = req_.get("add_text_input", 1);
-
-                TextParse cmd_{};
-                cmd_.add("itemID", {itemID});
-                cmd_.add("count", {"199"});
-                cmd_.add("dialog_name", {"trash_item"});
-                cmd_.add("action", {"dialog_return"});
-
-                std::string cmd = cmd_.get_raw();
-
-                ByteStream s{};
-                s.write<uint32_t>(2);
-                s.write_data(cmd.c_str(), cmd.length() + 1);
-
-                std::vector<std::byte> b{};
-                s.read_vector(b, 4 + cmd.length() + 1);
-                Sleep(100 + randrange(-50, 50));
-                std::ignore =
-                    core_->get_client()->get_player()->send_packet(b, 0);
-                evt.canceled = true;
+                std::ignore = player->send_packet(b, 0);
               }
+              evt.canceled = true;
             }
-            else if (fn_name == "OnConsoleMessage")
+          });
+      ext->append_call_function_listener(
+          "OnSetPos",
+          [&](const IParserExtension::EventCallFunction &evt)
+          {
+            if (!is_bound(evt.get_session()))
             {
-              std::string msg = evt_variant.get(1);
+              return;
+            }
 
-              std::string home = get_home_dir();
-              std::string path =
-                  format_string("%s\\.gtworlds\\messages.txt", home.c_str());
-              std::ofstream out(path, std::ios_base::app);
-              out.write(msg.data(), msg.length());
+            auto pos = evt.get_args().get<glm::vec2>(1);
+            world.my_x = pos.x;
+            world.my_y = pos.y;
+          });
+      ext->append_call_function_listener(
+          "OnSpawn",
+          [&](const IParserExtension::EventCallFunction &evt)
+          {
+            if (!is_bound(evt.get_session()))
+            {
+              return;
             }
-            else if (fn_name == "OnSetPos")
+
+            std::string kv = evt.get_args().get<std::string>(1);
+            TextParse req{kv};
+            if (req.contains("type"))
             {
-              auto pos = evt_variant.get<glm::vec2>(1);
-              world.my_x = pos.x;
-              world.my_y = pos.y;
+              world.my_net_id = req.get<uint32_t>("netID");
             }
-            else if (fn_name == "OnSpawn")
+            else
             {
-              std::string kv = evt_variant.get(1);
-              TextParse req{kv};
-              if (req.contains("type"))
-              {
-                world.my_net_id = req.get<uint32_t>("netID");
-              }
-              else
+              Player p;
+              p.type = req.get("spawn");
+              p.avatar = req.get("avatar");
+              p.net_id = req.get<uint32_t>("netID");
+              p.online_id = req.get("onlineID");
+              p.e_id = req.get("onlineID");
+              p.ip = req.get("ip");
+              p.col_rect = req.get("col_rect");
+              p.title_icon = req.get("title_icon");
+              p.m_state = req.get<uint32_t>("mstate");
+              p.user_id = req.get<uint32_t>("userID");
+              p.invisible = bool(req.get<uint32_t>("invis"));
+              p.name = req.get("name");
+              p.country = req.get("country");
+              p.x = 0;
+              p.y = 0;
+
+              if (req.contains("posXY"))
               {
-                Player p;
-                p.type = req.get("spawn");
-                p.avatar = req.get("avatar");
-                p.net_id = req.get<uint32_t>("netID");
-                p.online_id = req.get("onlineID");
-                p.e_id = req.get("onlineID");
-                p.ip = req.get("ip");
-                p.col_rect = req.get("col_rect");
-                p.title_icon = req.get("title_icon");
-                p.m_state = req.get<uint32_t>("mstate");
-                p.user_id = req.get<uint32_t>("userID");
-                p.invisible = bool(req.get<uint32_t>("invis"));
-                p.name = req.get("name");
-                p.country = req.get("country");
-                p.x = 0;
-                p.y = 0;
-
-                if (req.contains("posXY"))
-                {
-                  std::string pos = req.get("posXY");
-                  size_t sep = pos.find('|');
-                  p.x = std::stof(pos.substr(0, sep));
-                  p.y = std::stof(pos.substr(sep + 1));
-                }
+                std::string pos = req.get("posXY");
+                size_t sep = pos.find('|');
+                p.x = std::stof(pos.substr(0, sep));
+                p.y = std::stof(pos.substr(sep + 1));
               }
             }
-            else if (fn_name == "OnRemove")
+          });
+      ext->append_call_function_listener(
+          "OnRemove",
+          [&](const IParserExtension::EventCallFunction &evt)
+          {
+            if (!is_bound(evt.get_session()))
             {
-              std::string kv = evt_variant.get(1);
-              TextParse req{kv};
-              world.remove(req.get<uint32_t>("netID"));
+              return;
             }
-            else if (fn_name == "OnTalkBubble")
+
+            std::string kv = evt.get_args().get<std::string>(1);
+            TextParse req{kv};
+            world.remove(req.get<uint32_t>("netID"));
+          });
+      ext->append_call_function_listener(
+          "OnRequestWorldSelectMenu",
+          [&](const IParserExtension::EventCallFunction &evt)
+          {
+            if (!is_bound(evt.get_session()))
             {
-              std::string msg = evt_variant.get(2);
-              if (msg.contains("bro fish more please!!!"))
-              {
-                auto_fish = true;
-                sendThrowPacket(*core_->get_client()->get_player());
-              }
+              return;
             }
-            else if (fn_name == "OnRequestWorldSelectMenu")
+
+            if (auto_fish)
             {
-              if (auto_fish)
-              {
-                console_log("fs is turned off");
-                auto_fish = false;
-              }
+              console_log("fs is turned off");
+              auto_fish = false;
+            }
 
-              if (auto_break)
-              {
-                console_log("br is turned off");
-                auto_break = false;
-              }
-              world.reset();
+            if (auto_break)
+            {
+              console_log("br is turned off");
+              auto_break = false;
             }
+            world.reset();
           });
     }
 
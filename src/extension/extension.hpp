@@ -43,6 +43,9 @@ struct IExtension {
 	/**
 	 * @brief Called every tick.
 	 *
+	 * Runs on the thread servicing the server host, between its dispatches.
+	 * With core.ioModel "threaded" the client host has its own thread, which
+	 * may be dispatching server traffic at the same time.
 	 */
 	virtual void tick() { }
 
@@ -1,6 +1,12 @@
 #pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <eventpp/callbacklist.h>
+
 #include "../extension.hpp"
-#include "../../packet/packet_variant.hpp"
+#include "../../packet/variant_view.hpp"
+#include "../../core/session.hpp"
 #include "../../player/player.hpp"
 
 struct IParserExtension : extension::IExtension {
@@ -36,10 +42,12 @@ struct IParserExtension : extension::IExtension {
 
     EVENTPP_MAKE_EVENT(
         EventCallFunction, Event, (EventType::CallFunction, core::EventFrom::FromAny),
+        G(core::SessionPtr, session),
         G(player::Player, player),
         G(player::Player, target),
-        G(std::string, function_name),
-        G(packet::Variant, args)
+        G(std::string_view, function_name),
+        // Views into the received packet; copy with to_variant() to keep them.
+        G(packet::VariantView, args)
     );
 
     struct EventPolicies {
@@ -57,4 +65,34 @@ struct IParserExtension : extension::IExtension {
         EventPolicies
     >;
     [[nodiscard]] virtual EventDispatcher& get_event_dispatcher() = 0;
+
+    using CallFunctionCallbackList = eventpp::CallbackList<void(const EventCallFunction&), EventPolicies>;
+    using CallFunctionCallback = CallFunctionCallbackList::Callback;
+
+    struct CallFunctionStats {
+        std::string function_name;
+        // Times the server has sent it.
+        uint64_t count;
+    };
+
+    /**
+     * @brief Listen to a single call function from the server.
+     *
+     * The name is hashed once here; dispatching hashes the received name once
+     * and runs only that function's listeners, before the
+     * EventType::CallFunction ones. Register from init().
+     *
+     * @param function_name The function, e.g. "OnSendToServer".
+     * @param callback Run for every call of it.
+     */
+    virtual void append_call_function_listener(std::string_view function_name, const CallFunctionCallback& callback) = 0;
+    virtual void prepend_call_function_listener(std::string_view function_name, const CallFunctionCallback& callback) = 0;
+
+    /**
+     * @brief How often each function has been received so far.
+     *
+     * Covers every function with a listener. Functions without one are
+     * counted until 256 names are known in all. Call from the core's thread.
+     */
+    [[nodiscard]] virtual std::vector<CallFunctionStats> get_call_function_stats() const = 0;
 };
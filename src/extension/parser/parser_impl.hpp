@@ -1,11 +1,30 @@
 #pragma once
+#include <algorithm>
+#include <functional>
+#include <ranges>
+#include <tuple>
+#include <unordered_map>
+
 #include "parser.hpp"
 #include "../../core/core.hpp"
+#include "../../core/packet_log.hpp"
+#include "../../utils/hash.hpp"
 
 namespace extension::parser {
 class ParserExtension final : public IParserExtension {
+    struct CallFunction {
+        std::string name;
+        CallFunctionCallbackList listeners;
+        uint64_t count{ 0 };
+    };
+
+    // Names the server sends that nothing listens to are counted up to this many.
+    static constexpr std::size_t max_call_functions{ 256 };
+
     core::Core* core_;
     EventDispatcher event_dispatcher_;
+    // Keyed by the FNV-1a hash of the function name; names sharing a hash each keep their entry.
+    std::unordered_multimap<uint32_t, CallFunction> call_functions_;
 
 public:
     explicit ParserExtension(core::Core* core)
@@ -18,18 +37,10 @@ public:
 
     void init() override
     {
-        core_->get_event_dispatcher().prependListener(
-            core::EventType::Packet,
-            [this](const core::EventPacket& event)
-            {
-                switch (event.get_packet().type) {
-                case packet::PacketType::PACKET_CALL_FUNCTION:
-                    parse_call_function(event);
-                    break;
-                default:
-                    break;
-                }
-            }
+        core_->get_packet_dispatcher().prepend_listener(
+            packet::PacketType::PACKET_CALL_FUNCTION,
+            core::EventFrom::FromServer,
+            [this](const core::EventPacket& event) { parse_call_function(event); }
         );
     }
 
@@ -43,78 +54,108 @@ public:
         return event_dispatcher_;
     }
 
+    void append_call_function_listener(const std::string_view function_name, const CallFunctionCallback& callback) override
+    {
+        intern(function_name).listeners.append(callback);
+    }
+
+    void prepend_call_function_listener(const std::string_view function_name, const CallFunctionCallback& callback) override
+    {
+        intern(function_name).listeners.prepend(callback);
+    }
+
+    [[nodiscard]] std::vector<CallFunctionStats> get_call_function_stats() const override
+    {
+        std::vector<CallFunctionStats> stats{};
+        for (const auto& call_function : std::views::values(call_functions_)) {
+            if (call_function.count != 0) {
+                stats.push_back({ call_function.name, call_function.count });
+            }
+        }
+
+        std::ranges::sort(stats, std::greater{}, &CallFunctionStats::count);
+        return stats;
+    }
+
 private:
-    void parse_call_function(const core::EventPacket& event) const
+    // The entry for function_name, nullptr if there is none yet.
+    CallFunction* find(const uint32_t hash, const std::string_view function_name)
     {
-        if (event.from == core::EventFrom::FromClient) {
-            return;
+        auto [it, end]{ call_functions_.equal_range(hash) };
+        for (; it != end; ++it) {
+            if (it->second.name == function_name) {
+                return &it->second;
+            }
+        }
+
+        return nullptr;
+    }
+
+    CallFunction& add(const uint32_t hash, const std::string_view function_name)
+    {
+        CallFunction& call_function{
+            call_functions_.emplace(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple())->second
+        };
+        call_function.name = function_name;
+        return call_function;
+    }
+
+    // The entry for function_name, made on first use.
+    CallFunction& intern(const std::string_view function_name)
+    {
+        const uint32_t hash{ hash::fnv1a_32(function_name) };
+        if (CallFunction* call_function{ find(hash, function_name) }) {
+            return *call_function;
         }
 
-        packet::Variant variant{};
-        if (!variant.deserialize(event.get_ext_data())) {
+        return add(hash, function_name);
+    }
+
+    void parse_call_function(const core::EventPacket& event)
+    {
+        const packet::VariantView args{ event.get_ext_data() };
+        if (!args.valid()) {
             spdlog::warn("Failed to deserialize variant");
             return;
         }
 
-        std::vector variants{ variant.get_variants() };
-        if (variants.empty()) {
+        if (args.empty()) {
             spdlog::warn("Variants are empty");
             return;
         }
 
-        if (core_->get_config().get<bool>("log.printVariant"))  {
-            spdlog::info("Incoming variant from {}:", event.from == core::EventFrom::FromClient ? "client" : "server");
-            glm::vec2 vec2{0};
-            for (const auto& var : variants) {
-                switch (packet::Variant::get_type(var)) {
-                case packet::VariantType::FLOAT:
-                    spdlog::info("\t[FLOAT]: {}", std::get<float>(var));
-                    break;
-                case packet::VariantType::STRING: {
-                    TextParse text_parse{ std::get<std::string>(var) };
-                    if (!text_parse.empty()) {
-                        std::vector key_values{ text_parse.get_key_values() };
-                        if (key_values.size() == 1) {
-                            spdlog::info("\t[STRING]: {}", key_values[0]);
-                            break;
-                        }
-
-                        spdlog::info("\t[STRING]:");
-                        for (const auto& key_value : text_parse.get_key_values()) {
-                            spdlog::info("\t\t{}", key_value);
-                        }
-
-                        break;
-                    }
-
-                    spdlog::info("\t[STRING]: {}", std::get<std::string>(var));
-                    break;
-                }
-                case packet::VariantType::VEC2:
-                    vec2 = std::get<glm::vec2>(var);
-                    spdlog::info("\t[VEC2]: x: {}, y: {}", vec2.x, vec2.y);
-                    break;
-                case packet::VariantType::UNSIGNED:
-                    spdlog::info("\t[UNSIGNED]: {}", std::get<uint32_t>(var));
-                    break;
-                case packet::VariantType::SIGNED:
-                    spdlog::info("\t[SIGNED]: {}", std::get<int32_t>(var));
-                    break;
-                default:
-                    break;
-                }
-            }
+        if (core_->get_config().get_snapshot().log_print_variant)  {
+            core::PacketLog::write(core::PacketLogKind::Variant, event.from, event.get_ext_data());
         }
 
         const EventCallFunction event_call_function{
+            event.get_session(),
             event.get_player(),
             event.get_target(),
-            variant.get(0),
-            variant
+            args.get(0),
+            args
         };
         event_call_function.from = event.from;
 
-        event_dispatcher_.dispatch(event_call_function);
+        // Looked up without inserting; only a bounded number of unknown names get an entry for counting.
+        const std::string_view function_name{ event_call_function.get_function_name() };
+        const uint32_t hash{ hash::fnv1a_32(function_name) };
+        CallFunction* call_function{ find(hash, function_name) };
+        if (!call_function && call_functions_.size() < max_call_functions) {
+            call_function = &add(hash, function_name);
+        }
+
+        if (call_function) {
+            call_function->count++;
+            if (!call_function->listeners.empty()) {
+                call_function->listeners(event_call_function);
+            }
+        }
+
+        if (!event_call_function.canceled) {
+            event_dispatcher_.dispatch(event_call_function);
+        }
+
         event.canceled = event_call_function.canceled;
     }
 };
@@ -12,13 +12,9 @@ namespace extension::sub_server_switch {
 class SubServerSwitchExtension final : public ISubServerSwitchExtension {
     core::Core* core_;
 
-    std::string address_;
-    int port_;
-
 public:
     explicit SubServerSwitchExtension(core::Core* core)
         : core_{ core }
-        , port_{ -1 }
     {
 
     }
@@ -33,44 +29,12 @@ public:
             return;
         }
 
-        core_->get_event_dispatcher().prependListener(
-            core::EventType::Connection,
-            [&](const core::EventConnection& evt)
-            {
-                if (evt.from != core::EventFrom::FromClient) {
-                    return;
-                }
-
-                if (address_.empty() || port_ == -1) {
-                    return;
-                }
-
-                std::ignore = core_->get_client()->connect(address_, port_);
-
-                address_.clear();
-                port_ = -1;
-
-                evt.canceled = true;
-            }
-        );
-
-        ext->get_event_dispatcher().appendListener(
-            IParserExtension::EventType::CallFunction,
+        ext->append_call_function_listener(
+            "OnSendToServer",
             [this](const IParserExtension::EventCallFunction& evt)
             {
-                if (evt.from != core::EventFrom::FromServer) {
-                    return;
-                }
-
-                if (evt.get_function_name() != "OnSendToServer") {
-                    return;
-                }
-
-                const packet::Variant evt_variant{ evt.get_args() };
-                std::vector tokenize{ TextParse::tokenize(evt_variant.get(4)) };
-
-                address_ = tokenize.at(0);
-                port_ = evt_variant.get<int32_t>(1);
+                const packet::VariantView& evt_variant{ evt.get_args() };
+                std::vector tokenize{ TextParse::tokenize(evt_variant.get<std::string>(4)) };
 
                 packet::game::OnSendToServer packet{};
                 packet.port = core_->get_config().get<unsigned int>("enet.port");
@@ -84,6 +48,15 @@ public:
                     ? tokenize.at(1)
                     : tokenize.at(2);
                 packet.login_mode = evt_variant.get<int32_t>(5);
+
+                // The game client reconnects to us next and logs in with this
+                // ticket; that login's session goes on to the sub-server.
+                core_->get_redirects().push(
+                    core::RedirectTicket{ packet.token, packet.user, packet.uuid_token },
+                    tokenize.at(0),
+                    static_cast<enet_uint16>(evt_variant.get<int32_t>(1))
+                );
+
                 spdlog::info("{} {} {} {} {} {} {}", packet.port, packet.token, packet.user, packet.address, packet.door_id, packet.uuid_token, packet.login_mode);
                 packet::PacketHelper::send(packet, evt.get_target());
                 evt.canceled = true;
@@ -14,38 +14,18 @@ class WebServerExtension final : public IWebServerExtension {
   core::Core *core_;
   httplib::SSLServer server_;
 
-  std::string address_;
-  uint16_t port_;
-
 public:
   explicit WebServerExtension(core::Core *core)
-      : core_{core}, server_{"./resources/cert.pem", "./resources/key.pem"},
-        port_{65535} {}
+      : core_{core}, server_{"./resources/cert.pem", "./resources/key.pem"} {}
 
   ~WebServerExtension() override { server_.stop(); }
 
   void init() override {
-    core_->get_event_dispatcher().prependListener(
-        core::EventType::Connection, [&](const core::EventConnection &evt) {
-          if (evt.from != core::EventFrom::FromClient) {
-            return;
-          }
-
-          // Only allow localhost to redirect to the server.
-          if (evt.get_player().get_peer()->address.host != 16777343) {
-            return;
-          }
-
-          if (address_.empty() || port_ == 65535) {
-            return;
-          }
-
-          std::ignore = core_->get_client()->connect(address_, port_);
-          evt.canceled = true;
-
-          address_.clear();
-          port_ = 65535;
-        });
+    // Every shard has an instance, but only one can own port 443. Redirects go
+    // through the shared table, so any shard can pick them up.
+    if (core_->get_shard() != 0) {
+      return;
+    }
 
     server_.set_logger(
         [](const httplib::Request &req, const httplib::Response &res) {
@@ -244,8 +224,14 @@ protected:
           }
 
           // Set server address and port that client (Proxy) should connect to.
-          address_ = text_parse.get("server");
-          port_ = std::stoi(text_parse.get("port"));
+          // Used by the first login from the address that asked.
+          ENetAddress requester{};
+          if (enet_address_set_host_ip(&requester, req.remote_addr.c_str()) ==
+              0) {
+            core_->get_redirects().push(
+                requester.host, text_parse.get("server"),
+                static_cast<enet_uint16>(std::stoi(text_parse.get("port"))));
+          }
 
           // Set server address and port that client (Growtopia) should connect
           // to.
@@ -1,5 +1,7 @@
 #include "core/core.hpp"
 #include "core/logger.hpp"
+#include "core/packet_log.hpp"
+#include "core/shard_group.hpp"
 
 #include "extension/parser/parser_impl.hpp"
 #include "extension/sub_server_switch/sub_server_switch_impl.hpp"
@@ -36,23 +38,27 @@ int main()
             GTPROXY_VERSION_PATCH
         );
 
-        core::Core core{};
+        core::ShardGroup shards{ [](core::Core& core) {
+            /**
+             * Register event listeners and handle events by adding extensions to the core
+             *
+             * Extensions serve as the primary mechanism to enhance the core's functionality.
+             * They allow the addition of new features, such as a web server or a parser.
+             *
+             * This process involves using the dispatch pattern to listen for events emitted by the core.
+             * Every shard gets its own instances.
+             */
+            core.add_extension(new extension::web_server::WebServerExtension{ &core });
+            core.add_extension(new extension::parser::ParserExtension{ &core });
+            core.add_extension(new extension::sub_server_switch::SubServerSwitchExtension{ &core });
+            core.add_extension(new extension::command_handler::CommandHandlerExtension{ &core });
+        } };
 
-        /**
-         * Register event listeners and handle events by adding extensions to the core
-         *
-         * Extensions serve as the primary mechanism to enhance the core's functionality.
-         * They allow the addition of new features, such as a web server or a parser.
-         *
-         * This process involves using the dispatch pattern to listen for events emitted by the core.
-         */
-        core.add_extension(new extension::web_server::WebServerExtension{ &core });
-        core.add_extension(new extension::parser::ParserExtension{ &core });
-        core.add_extension(new extension::sub_server_switch::SubServerSwitchExtension{ &core });
-        core.add_extension(new extension::command_handler::CommandHandlerExtension{ &core });
+        // Shared by every shard; formats packet dumps off the I/O threads if log.async is on.
+        core::PacketLog packet_log{ shards.get_config().get_snapshot().log_async };
 
-        // Run the core (Will block the main thread until the core is stopped)
-        core.run();
+        // Run every shard (Will block the main thread until the cores are stopped)
+        shards.run();
     }
     catch (const std::runtime_error& e) {
         spdlog::error("Runtime error: {}", e.what());
@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+#include <enet/enet.h>
+#include <magic_enum/magic_enum.hpp>
+#include <spdlog/spdlog.h>
+
+#include "packet_types.hpp"
+#include "../utils/text_parse.hpp"
+
+namespace packet {
+// Delivery flags a received packet keeps when it is forwarded.
+inline constexpr enet_uint32 forwarded_flags{
+    ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT
+};
+
+// How a forwarded packet goes out on the other host.
+struct ForwardRoute {
+    enet_uint32 flags;
+    enet_uint8 channel;
+};
+
+/**
+ * @brief Per-PacketType overrides for the flags and channel of forwarded game packets.
+ *
+ * Built from the "forward.overrides" config list. Each entry reads
+ * "PACKET_TYPE:flags:channel", where flags is one of "reliable", "unreliable",
+ * "unsequenced" or "keep", and channel is a number or "keep". For example
+ * "PACKET_STATE:unreliable:1".
+ */
+class ForwardOverrides {
+public:
+    ForwardOverrides() = default;
+
+    explicit ForwardOverrides(const std::vector<std::string>& entries)
+    {
+        for (const auto& entry : entries) {
+            if (!add(entry)) {
+                spdlog::warn("Ignoring invalid forward override \"{}\"", entry);
+            }
+        }
+    }
+
+    void apply(const PacketType type, ForwardRoute& route) const
+    {
+        const auto& override{ overrides_[magic_enum::enum_integer(type)] };
+        if (!override) {
+            return;
+        }
+
+        if (override->flags) {
+            route.flags = *override->flags;
+        }
+
+        if (override->channel) {
+            route.channel = *override->channel;
+        }
+    }
+
+    [[nodiscard]] bool empty() const { return empty_; }
+
+private:
+    struct Override {
+        std::optional<enet_uint32> flags;
+        std::optional<enet_uint8> channel;
+    };
+
+    bool add(const std::string& entry)
+    {
+        const std::vector tokens{ TextParse::tokenize(entry, ":") };
+        if (tokens.size() != 3) {
+            return false;
+        }
+
+        const auto type{ magic_enum::enum_cast<PacketType>(tokens[0]) };
+        if (!type) {
+            return false;
+        }
+
+        Override override{};
+        if (tokens[1] == "reliable") {
+            override.flags = ENET_PACKET_FLAG_RELIABLE;
+        }
+        else if (tokens[1] == "unreliable") {
+            override.flags = 0;
+        }
+        else if (tokens[1] == "unsequenced") {
+            override.flags = ENET_PACKET_FLAG_UNSEQUENCED;
+        }
+        else if (tokens[1] != "keep") {
+            return false;
+        }
+
+        if (tokens[2] != "keep") {
+            try {
+                const int channel{ std::stoi(tokens[2]) };
+                if (channel < 0 || channel >= ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
+                    return false;
+                }
+
+                override.channel = static_cast<enet_uint8>(channel);
+            }
+            catch (const std::exception&) {
+                return false;
+            }
+        }
+
+        overrides_[magic_enum::enum_integer(*type)] = override;
+        empty_ = false;
+        return true;
+    }
+
+    std::array<std::optional<Override>, 256> overrides_{};
+    bool empty_{ true };
+};
+}
@@ -95,9 +95,9 @@ public:
         return byte_stream.get_data();
     }
 
-    [[nodiscard]] bool deserialize(const std::vector<std::byte>& data)
+    [[nodiscard]] bool deserialize(const std::span<const std::byte> data)
     {
-        ByteStream<uint32_t> byte_stream{ const_cast<std::byte*>(data.data()), data.size() };
+        ByteStreamView<uint32_t> byte_stream{ data };
 
         uint8_t size{ 0 };
         byte_stream.read(size);
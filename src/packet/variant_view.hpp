@@ -0,0 +1,247 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <glm/glm.hpp>
+
+#include "packet_variant.hpp"
+
+namespace packet {
+/**
+ * @brief Typed, read-only access to serialized Variant data without copying it.
+ *
+ * Nothing is read until the first accessor call. That call walks the data once,
+ * checking that every entry has a known type and fits, and remembers where the
+ * first entries start. Strings are returned as views into the data, so the data
+ * must outlive the view; use to_variant() to keep or edit the arguments.
+ *
+ * Like Variant::get(), asking for the wrong type or an index that is out of
+ * range gives a default value. Invalid data reads as empty.
+ */
+class VariantView {
+public:
+    VariantView() = default;
+
+    explicit VariantView(const std::span<const std::byte> data)
+        : data_{ data }
+    {
+
+    }
+
+    // Whether every entry is complete and of a known type.
+    [[nodiscard]] bool valid() const { return check(); }
+    [[nodiscard]] std::size_t size() const { return check() ? size_ : 0; }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    [[nodiscard]] VariantType get_type(const std::size_t index) const
+    {
+        const auto offset{ find(index) };
+        return offset ? get_type_at(*offset) : VariantType::UNKNOWN;
+    }
+
+    /**
+     * @brief The argument at index as T.
+     *
+     * T is std::string_view (the default), std::string (a copy), float,
+     * glm::vec2, glm::vec3, uint32_t or int32_t.
+     */
+    template <typename T = std::string_view>
+    [[nodiscard]] T get(const std::size_t index) const
+    {
+        const auto offset{ find(index) };
+        if (!offset || get_type_at(*offset) != type_of<T>()) {
+            return T{};
+        }
+
+        const std::size_t value{ *offset + 2 };
+        if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+            return T{ reinterpret_cast<const char*>(data_.data() + value + sizeof(uint32_t)), read<uint32_t>(value) };
+        }
+        else if constexpr (std::is_same_v<T, glm::vec2>) {
+            return { read<float>(value), read<float>(value + 4) };
+        }
+        else if constexpr (std::is_same_v<T, glm::vec3>) {
+            return { read<float>(value), read<float>(value + 4), read<float>(value + 8) };
+        }
+        else {
+            return read<T>(value);
+        }
+    }
+
+    // An owning copy of every argument.
+    [[nodiscard]] Variant to_variant() const
+    {
+        Variant variant{};
+        for (std::size_t i{ 0 }; i < size(); i++) {
+            switch (get_type(i)) {
+            case VariantType::FLOAT:
+                variant.add(get<float>(i));
+                break;
+            case VariantType::STRING:
+                variant.add(get<std::string>(i));
+                break;
+            case VariantType::VEC2:
+                variant.add(get<glm::vec2>(i));
+                break;
+            case VariantType::VEC3:
+                variant.add(get<glm::vec3>(i));
+                break;
+            case VariantType::UNSIGNED:
+                variant.add(get<uint32_t>(i));
+                break;
+            case VariantType::SIGNED:
+                variant.add(get<int32_t>(i));
+                break;
+            default:
+                break;
+            }
+        }
+
+        return variant;
+    }
+
+    [[nodiscard]] std::span<const std::byte> get_data() const { return data_; }
+
+private:
+    enum class State : uint8_t {
+        Unchecked,
+        Valid,
+        Invalid
+    };
+
+    // Call functions rarely have more arguments; later ones are found by walking on.
+    static constexpr std::size_t indexed_count{ 16 };
+
+    template <typename T>
+    static consteval VariantType type_of()
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            return VariantType::FLOAT;
+        }
+        else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+            return VariantType::STRING;
+        }
+        else if constexpr (std::is_same_v<T, glm::vec2>) {
+            return VariantType::VEC2;
+        }
+        else if constexpr (std::is_same_v<T, glm::vec3>) {
+            return VariantType::VEC3;
+        }
+        else if constexpr (std::is_same_v<T, uint32_t>) {
+            return VariantType::UNSIGNED;
+        }
+        else if constexpr (std::is_same_v<T, int32_t>) {
+            return VariantType::SIGNED;
+        }
+        else {
+            static_assert(sizeof(T) == 0, "not a Variant type");
+        }
+    }
+
+    template <typename T>
+    [[nodiscard]] T read(const std::size_t offset) const
+    {
+        T value;
+        std::memcpy(&value, data_.data() + offset, sizeof(T));
+        return value;
+    }
+
+    [[nodiscard]] VariantType get_type_at(const std::size_t offset) const
+    {
+        return static_cast<VariantType>(data_[offset + 1]);
+    }
+
+    // Bytes taken by the entry at offset (index, type, value), or 0 if it is unknown or cut off.
+    [[nodiscard]] std::size_t get_entry_size(const std::size_t offset) const
+    {
+        if (offset + 2 > data_.size()) {
+            return 0;
+        }
+
+        std::size_t size{ 2 };
+        switch (get_type_at(offset)) {
+        case VariantType::FLOAT:
+        case VariantType::UNSIGNED:
+        case VariantType::SIGNED:
+            size += 4;
+            break;
+        case VariantType::VEC2:
+            size += 8;
+            break;
+        case VariantType::VEC3:
+            size += 12;
+            break;
+        case VariantType::STRING:
+            if (offset + 2 + sizeof(uint32_t) > data_.size()) {
+                return 0;
+            }
+
+            size += sizeof(uint32_t) + read<uint32_t>(offset + 2);
+            break;
+        default:
+            return 0;
+        }
+
+        return offset + size <= data_.size() ? size : 0;
+    }
+
+    bool check() const
+    {
+        if (state_ != State::Unchecked) {
+            return state_ == State::Valid;
+        }
+
+        state_ = State::Invalid;
+        if (data_.empty()) {
+            return false;
+        }
+
+        size_ = static_cast<uint8_t>(data_[0]);
+        std::size_t offset{ 1 };
+        for (std::size_t i{ 0 }; i < size_; i++) {
+            if (i < indexed_count) {
+                offsets_[i] = static_cast<uint32_t>(offset);
+            }
+
+            const std::size_t entry_size{ get_entry_size(offset) };
+            if (entry_size == 0) {
+                return false;
+            }
+
+            offset += entry_size;
+        }
+
+        state_ = State::Valid;
+        return true;
+    }
+
+    // Where the entry at index starts, if there is one.
+    [[nodiscard]] std::optional<std::size_t> find(const std::size_t index) const
+    {
+        if (!check() || index >= size_) {
+            return std::nullopt;
+        }
+
+        if (index < indexed_count) {
+            return offsets_[index];
+        }
+
+        std::size_t offset{ offsets_[indexed_count - 1] };
+        for (std::size_t i{ indexed_count - 1 }; i < index; i++) {
+            offset += get_entry_size(offset);
+        }
+
+        return offset;
+    }
+
+    std::span<const std::byte> data_;
+    mutable State state_{ State::Unchecked };
+    mutable uint8_t size_{ 0 };
+    mutable std::array<uint32_t, indexed_count> offsets_{};
+};
+}
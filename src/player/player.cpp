@@ -1,13 +1,35 @@
 #include "player.hpp"
 
 namespace player {
-bool Player::send_packet(const std::vector<std::byte>& data, const int channel) const
+bool Player::send_packet(const std::span<const std::byte> data, const int channel, const enet_uint32 flags) const
 {
     if (data.size() < 4 || data.size() > 786432 /* 768kb should be enough */) {
         return false;
     }
 
-    ENetPacket* packet{ enet_packet_create(data.data(), data.size(), ENET_PACKET_FLAG_RELIABLE) };
+    return send_packet(enet_packet_create(data.data(), data.size(), flags), channel);
+}
+
+bool Player::send_packet(ENetPacket* packet, int channel) const
+{
+    if (!packet) {
+        return false;
+    }
+
+    if (channel < 0 || static_cast<std::size_t>(channel) >= peer_->channelCount) {
+        channel = 0;
+    }
+
+    if (queue_) {
+        queue_->push({
+            core::CommandQueue::CommandType::Send,
+            peer_,
+            packet,
+            static_cast<enet_uint8>(channel)
+        });
+        return true;
+    }
+
     if (const int ret{ enet_peer_send(peer_, channel, packet) }; ret != 0) {
         enet_packet_destroy(packet);
         return false;
@@ -15,4 +37,26 @@ bool Player::send_packet(const std::vector<std::byte>& data, const int channel)
 
     return true;
 }
+
+void Player::issue(const core::CommandQueue::CommandType type) const
+{
+    if (queue_) {
+        queue_->push({ type, peer_ });
+        return;
+    }
+
+    switch (type) {
+    case core::CommandQueue::CommandType::Disconnect:
+        enet_peer_disconnect(peer_, 0);
+        break;
+    case core::CommandQueue::CommandType::DisconnectNow:
+        enet_peer_disconnect_now(peer_, 0);
+        break;
+    case core::CommandQueue::CommandType::DisconnectLater:
+        enet_peer_disconnect_later(peer_, 0);
+        break;
+    default:
+        break;
+    }
+}
 }
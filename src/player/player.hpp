@@ -1,27 +1,37 @@
 #pragma once
-#include <vector>
+#include <span>
 #include <enet/enet.h>
 
+#include "../core/command_queue.hpp"
+
 namespace player {
 class Player  {
 public:
-    Player() : peer_{ nullptr } {}
-    Player(const Player& other) noexcept { peer_ = other.peer_; }
-    explicit Player(ENetPeer* peer) : peer_{ peer } {}
+    Player() : peer_{ nullptr }, queue_{ nullptr } {}
+    Player(const Player& other) noexcept { peer_ = other.peer_; queue_ = other.queue_; }
+    explicit Player(ENetPeer* peer, core::CommandQueue* queue = nullptr) : peer_{ peer }, queue_{ queue } {}
     ~Player() = default;
 
     [[nodiscard]] bool is_connected() const { return peer_->state == ENET_PEER_STATE_CONNECTED; }
     [[nodiscard]] bool is_disconnected() const { return peer_->state == ENET_PEER_STATE_DISCONNECTED; }
 
-    void disconnect() const { enet_peer_disconnect(peer_, 0); }
-    void disconnect_now() const { enet_peer_disconnect_now(peer_, 0); }
-    void disconnect_later() const { enet_peer_disconnect_later(peer_, 0); }
+    void disconnect() const { issue(core::CommandQueue::CommandType::Disconnect); }
+    void disconnect_now() const { issue(core::CommandQueue::CommandType::DisconnectNow); }
+    void disconnect_later() const { issue(core::CommandQueue::CommandType::DisconnectLater); }
 
-    bool send_packet(const std::vector<std::byte>& data, int channel = 0) const;
+    bool send_packet(std::span<const std::byte> data, int channel = 0, enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE) const;
+    // Takes ownership of the packet, also when sending fails. Channels the peer
+    // does not have fall back to channel 0.
+    bool send_packet(ENetPacket* packet, int channel = 0) const;
 
     [[nodiscard]] ENetPeer* get_peer() const { return peer_; }
 
 private:
+    // Run the command on the host's own thread if the player is bound to a queue,
+    // otherwise touch the peer directly.
+    void issue(core::CommandQueue::CommandType type) const;
+
     ENetPeer* peer_;
+    core::CommandQueue* queue_;
 };
 }
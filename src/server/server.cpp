@@ -1,21 +1,35 @@
 #include <magic_enum/magic_enum.hpp>
-#include <spdlog/fmt/bin_to_hex.h>
 #include <spdlog/spdlog.h>
 
 #include "../client/client.hpp"
+#include "../core/packet_log.hpp"
+#include "../packet/packet_helper.hpp"
+#include "../packet/message/core.hpp"
 #include "../packet/packet_types.hpp"
 #include "../utils/byte_stream.hpp"
 #include "../utils/network.hpp"
 #include "server.hpp"
 
 namespace server {
-Server::Server(core::Core *core) : core_{core}, player_{nullptr} {
+Server::Server(core::Core *core) : core_{core} {
   ENetAddress address{};
   address.host = ENET_HOST_ANY;
   address.port = core->get_config().get<unsigned int>("enet.port");
 
-  host_ = enet_host_create(&address, 1, 2, 0, 0);
+  // One peer per game client; each becomes its own session.
+  const std::size_t max_sessions{std::max(
+      core->get_config().get<unsigned int>("core.maxSessions"), 1u)};
+
+  // Shards listen on the same port and let the kernel spread the clients.
+  if (core->get_shard_count() > 1) {
+    host_ = enet_host_create_shared(&address, max_sessions, 2, 0, 0);
+  } else {
+    host_ = enet_host_create(&address, max_sessions, 2, 0, 0);
+  }
+
   if (!host_) {
+    spdlog::error("Failed to create the server host on port {}",
+                  address.port);
     return;
   }
 
@@ -26,24 +40,50 @@ Server::Server(core::Core *core) : core_{core}, player_{nullptr} {
   host_->checksum = enet_crc32;
   host_->usingNewPacketForServer = 1;
 
-  spdlog::info(
-      "The server is up and running with port {} and {} peers can join!",
-      host_->address.port, host_->peerCount);
-}
+  if (const core::ConfigSnapshot &config{core->get_config().get_snapshot()};
+      config.capture_enabled) {
+    capture_ = std::make_unique<core::PacketCapture>(
+        config.capture_directory,
+        fmt::format("shard{}-from-client", core->get_shard()),
+        std::size_t{config.capture_segment_size} * 1024 * 1024,
+        config.capture_max_segments);
+  }
 
-Server::~Server() {
-  enet_host_destroy(host_);
-  delete player_;
+  if (const core::ConfigSnapshot &config{core->get_config().get_snapshot()};
+      config.flight_recorder_enabled) {
+    flight_recorder_ = std::make_unique<core::FlightRecorder>(
+        config.flight_recorder_directory,
+        fmt::format("shard{}-from-client", core->get_shard()),
+        std::chrono::seconds{config.flight_recorder_seconds},
+        config.flight_recorder_max_dumps);
+  }
+
+  spdlog::info("The server (shard {}) is up and running with port {} and {} "
+               "peers can join!",
+               core->get_shard(), host_->address.port, host_->peerCount);
 }
 
-void Server::process() {
+Server::~Server() { enet_host_destroy(host_); }
+
+void Server::process(const enet_uint32 timeout) {
   // Perform server processing here
   if (!host_) {
     return;
   }
 
+  const core::CommandQueue::ServicingScope servicing{command_queue_};
+
+  // Run whatever other threads queued for our peers before servicing, so the
+  // sends go out with this service call.
+  const auto on_disconnect_now{[this](ENetPeer *peer) { on_disconnect(peer); }};
+  command_queue_.drain(host_, on_disconnect_now);
+
+  if (flight_recorder_) {
+    flight_recorder_->service();
+  }
+
   ENetEvent ev{};
-  while (enet_host_service(host_, &ev, 16) > 0) {
+  while (enet_host_service(host_, &ev, timeout) > 0) {
     switch (ev.type) {
     case ENET_EVENT_TYPE_CONNECT:
       on_connect(ev.peer);
@@ -52,11 +92,13 @@ void Server::process() {
       on_disconnect(ev.peer);
       break;
     case ENET_EVENT_TYPE_RECEIVE:
-      on_receive(ev.peer, ev.packet);
+      on_receive(ev.peer, ev.packet, ev.channelID);
       break;
     default:
       break;
     }
+
+    command_queue_.drain(host_, on_disconnect_now);
   }
 }
 
@@ -68,105 +110,181 @@ void Server::on_connect(ENetPeer *peer) {
   // GOOD JOB GROWTOPIA TEAM! PLEASE MAKE YOUR CLIENTS HANG LONGER!!!
   // enet_peer_timeout(peer, 0, 12000, 0);
 
-  player_ = new player::Player{peer};
+  core::SessionTable &sessions{core_->get_sessions()};
+
+  const auto player{std::make_shared<player::Player>(peer, &command_queue_)};
+  const auto session{sessions.create(player)};
+  peer->data = session.get();
 
-  const core::EventConnection event_connection{*player_};
+  spdlog::info("Session #{} started ({} active)", session->get_id(),
+               sessions.size());
+
+  // Greeted here instead of by the real server: the upstream is only
+  // connected once the login says where it should go.
+  packet::core::ServerHello server_hello{};
+  packet::PacketHelper::send(server_hello, *player);
+
+  const core::EventConnection event_connection{session.get(), *player};
   event_connection.from = core::EventFrom::FromClient;
   core_->get_event_dispatcher().dispatch(event_connection);
 }
 
-void Server::on_receive(ENetPeer *peer, ENetPacket *packet) {
-  if (!player_) {
+void Server::on_receive(ENetPeer *peer, ENetPacket *packet,
+                        const enet_uint8 channel) {
+  // The stream below reads straight out of the packet, so it is only freed
+  // once forwarding is done.
+  std::unique_ptr<ENetPacket, decltype(&enet_packet_destroy)> packet_guard{
+      packet, &enet_packet_destroy};
+
+  auto *session{static_cast<core::Session *>(peer->data)};
+  if (capture_) {
+    capture_->write(core::EventFrom::FromClient,
+                    session ? session->get_id() : 0, channel, packet->flags,
+                    {reinterpret_cast<const std::byte *>(packet->data),
+                     packet->dataLength});
+  }
+
+  if (flight_recorder_) {
+    flight_recorder_->record(
+        core::EventFrom::FromClient, session ? session->get_id() : 0, channel,
+        packet->flags,
+        {reinterpret_cast<const std::byte *>(packet->data), packet->dataLength});
+  }
+
+  const auto player{session ? session->get_downstream() : nullptr};
+  if (!player) {
     enet_peer_disconnect(peer, 0);
     return;
   }
 
-  const player::Player *to_player{core_->get_client()->get_player()};
+  if (!session->is_upstream_requested() &&
+      !request_upstream(*session, *player, packet)) {
+    player->disconnect();
+    return;
+  }
+
+  switch (session->hold(packet, channel)) {
+  case core::HoldResult::Held:
+    std::ignore = packet_guard.release();
+    return;
+  case core::HoldResult::Full:
+    spdlog::warn("Session #{} sent too much before its upstream was ready",
+                 session->get_id());
+    player->disconnect();
+    return;
+  case core::HoldResult::Released:
+    break;
+  }
+
+  const auto to_player{session->get_upstream()};
   if (!to_player) {
-    player_->disconnect();
+    player->disconnect();
     return;
   }
 
-  ByteStream byte_stream{reinterpret_cast<std::byte *>(packet->data),
-                         packet->dataLength};
+  // Untouched traffic goes out as the very packet we received, so forwarding
+  // neither copies nor allocates. Nothing may read byte_stream afterwards.
+  // Reliability and channel are carried over unless overridden per type.
+  packet::ForwardRoute route{packet->flags & packet::forwarded_flags, channel};
+  const auto forward_original{[&] {
+    ENetPacket *original{packet_guard.release()};
+    original->flags = route.flags;
+    std::ignore = to_player->send_packet(original, route.channel);
+  }};
+
+  ByteStreamView byte_stream{reinterpret_cast<const std::byte *>(packet->data),
+                             packet->dataLength};
   if (byte_stream.get_size() <
       4 /* || byte_stream.get_size() > 16384 */ /* 16kb */) {
-    player_->disconnect();
+    player->disconnect();
     return;
   }
 
-  enet_packet_destroy(packet);
-
   packet::NetMessageType type{};
   if (!byte_stream.read(type)) {
-    player_->disconnect();
+    player->disconnect();
     return;
   }
 
   if (type == packet::NET_MESSAGE_GENERIC_TEXT ||
       type == packet::NET_MESSAGE_GAME_MESSAGE) {
-    std::string message{};
-    byte_stream.read(message, byte_stream.get_size() -
-                                  sizeof(packet::NetMessageType) - 1);
-
-    TextParse text_parse{message};
-    if (core_->get_config().get<bool>("log.printMessage")) {
-      spdlog::info("Incoming message from client:");
-      for (const auto &key_value : text_parse.get_key_values()) {
-        spdlog::info("\t{}", key_value);
-      }
+    // The text stays in the receive buffer; only its index is built.
+    std::span<const std::byte> text{};
+    std::ignore = byte_stream.read_span(
+        text, byte_stream.get_size() - sizeof(packet::NetMessageType) - 1);
+
+    const std::string_view message{reinterpret_cast<const char *>(text.data()),
+                                   text.size()};
+    message_view_.parse(message);
+
+    if (core_->get_config().get_snapshot().log_print_message) {
+      core::PacketLog::write(core::PacketLogKind::Message,
+                             core::EventFrom::FromClient, text);
     }
 
-    const core::EventMessage event_message{*player_, *to_player, text_parse};
+    // Checked up front: forwarding hands the buffer over to ENet.
+    const bool quit{message.find("action|quit") != std::string_view::npos &&
+                    message.find("action|quit_to_exit") ==
+                        std::string_view::npos};
+
+    const core::EventMessage event_message{session, *player, *to_player,
+                                           message_view_};
     event_message.from = core::EventFrom::FromClient;
-    core_->get_event_dispatcher().dispatch(event_message);
+    core_->dispatch(event_message);
 
+    // Edited messages are re-encoded; the rest go out as received.
     if (!event_message.canceled) {
-      std::ignore = to_player->send_packet(byte_stream.get_data(), 0);
+      if (event_message.is_dirty()) {
+        std::ignore = to_player->send_packet(event_message.serialize(type),
+                                             route.channel, route.flags);
+      } else {
+        forward_original();
+      }
     }
 
-    if (message.find("action|quit") != std::string::npos &&
-        message.find("action|quit_to_exit") == std::string::npos) {
-      player_->disconnect();
+    if (quit) {
+      player->disconnect();
     }
   } else if (type == packet::NET_MESSAGE_GAME_PACKET) {
     packet::GameUpdatePacket game_update_packet{};
     byte_stream.read(game_update_packet);
 
-    std::vector<std::byte> ext_data{};
-    if (game_update_packet.data_size > 0) {
-      byte_stream.read_vector(ext_data, game_update_packet.data_size);
-    }
-
     if (game_update_packet.type ==
         packet::PacketType::PACKET_APP_INTEGRITY_FAIL)
       return;
 
-    const core::EventPacket event_packet{*player_, *to_player,
+    const core::EventPacket event_packet{session, *player, *to_player,
                                          game_update_packet,
-                                         byte_stream.get_data(), ext_data};
+                                         byte_stream.get_data()};
     event_packet.from = core::EventFrom::FromClient;
-    core_->get_event_dispatcher().dispatch(event_packet);
-
-    if (core_->get_config().get<bool>("log.printGameUpdatePacket")) {
-      spdlog::info("Incoming GameUpdatePacket {} ({}) from client: {:p}\n  EXT({}/{})={:p}\n",
-                   magic_enum::enum_name(game_update_packet.type),
-                   magic_enum::enum_integer(game_update_packet.type),
-                   spdlog::to_hex(byte_stream.get_data()),
-                   game_update_packet.data_size,
-                   ext_data.size(),
-                   spdlog::to_hex(ext_data));
+    core_->dispatch(event_packet);
+
+    if (core_->get_config().get_snapshot().log_print_game_update_packet) {
+      core::PacketLog::write(core::PacketLogKind::GameUpdatePacket,
+                             core::EventFrom::FromClient,
+                             event_packet.get_data());
     }
 
     if (!event_packet.canceled) {
-      std::ignore = to_player->send_packet(byte_stream.get_data(), 0);
+      core_->get_forward_overrides().apply(game_update_packet.type, route);
+
+      // Header edits are patched into the received packet; only replaced
+      // extended data costs a new one.
+      const std::span<std::byte> buffer{
+          reinterpret_cast<std::byte *>(packet->data), packet->dataLength};
+      if (const auto rebuilt{event_packet.write_back(buffer)}; rebuilt) {
+        std::ignore =
+            to_player->send_packet(*rebuilt, route.channel, route.flags);
+      } else {
+        forward_original();
+      }
     }
 
     if (game_update_packet.type == packet::PACKET_DISCONNECT) {
       // Because Growtopia's client is force recreate the ENetHost when the
       // client is disconnected, we need to disconnect the client immediately.
-      player_->disconnect_now();
-      on_disconnect(peer);
+      // The queued command resets the peer and runs on_disconnect for us.
+      player->disconnect_now();
     }
   } else {
     spdlog::warn("Got an unknown packet type coming in from the address {}:{}:",
@@ -174,33 +292,67 @@ void Server::on_receive(ENetPeer *peer, ENetPacket *packet) {
                  peer->address.port);
     spdlog::warn("\t{} ({})", magic_enum::enum_name(type),
                  magic_enum::enum_integer(type));
-    std::ignore = to_player->send_packet(byte_stream.get_data(), 0);
+    forward_original();
   }
 }
 
+bool Server::request_upstream(core::Session &session,
+                              const player::Player &player,
+                              const ENetPacket *packet) {
+  ByteStreamView byte_stream{reinterpret_cast<const std::byte *>(packet->data),
+                             packet->dataLength};
+
+  // The game client answers our hello with its login before anything else.
+  packet::NetMessageType type{};
+  if (byte_stream.get_size() < 4 || !byte_stream.read(type) ||
+      type != packet::NET_MESSAGE_GENERIC_TEXT) {
+    return false;
+  }
+
+  std::span<const std::byte> text{};
+  std::ignore = byte_stream.read_span(
+      text, byte_stream.get_size() - sizeof(packet::NetMessageType) - 1);
+  message_view_.parse(
+      {reinterpret_cast<const char *>(text.data()), text.size()});
+
+  session.set_upstream_requested();
+  core_->get_client()->connect(&session, message_view_,
+                               player.get_peer()->address.host);
+  return true;
+}
+
 void Server::on_disconnect(ENetPeer *peer) {
   spdlog::info("The server just lost a connection from the address {}:{}!",
                network::format_ip_address(peer->address.host),
                peer->address.port);
 
-  if (!player_) {
+  auto *session{static_cast<core::Session *>(peer->data)};
+  if (!session) {
     return;
   }
 
-  const core::EventDisconnection event_disconnection{*player_};
-  event_disconnection.from = core::EventFrom::FromClient;
-  core_->get_event_dispatcher().dispatch(event_disconnection);
+  peer->data = nullptr;
 
-  delete player_;
-  player_ = nullptr;
+  if (const auto player{session->detach_downstream()}; player) {
+    const core::EventDisconnection event_disconnection{session, *player};
+    event_disconnection.from = core::EventFrom::FromClient;
+    core_->get_event_dispatcher().dispatch(event_disconnection);
+  }
 
-  const player::Player *to_player{core_->get_client()->get_player()};
-  if (!to_player) {
-    return;
+  // An upstream still connecting sees the detached downstream in
+  // Client::on_connect and drops itself.
+  if (const auto to_player{session->get_upstream()}; to_player) {
+    enet_host_flush(host_); // Flush all outgoing packets before disconnecting
+    // The client loop resets its peer and runs its own on_disconnect.
+    to_player->disconnect_now();
+  }
+
+  // A PACKET_DISCONNECT from the game client ends up here as well.
+  if (flight_recorder_) {
+    flight_recorder_->dump(session->get_id(), "disconnect");
   }
 
-  enet_host_flush(host_); // Flush all outgoing packets before disconnecting
-  to_player->disconnect_now();
-  core_->get_client()->on_disconnect(to_player->get_peer());
+  spdlog::info("Session #{} lost its game client", session->get_id());
+  core_->get_sessions().release(*session);
 }
 } // namespace server
@@ -1,8 +1,11 @@
 #pragma once
 #include <enet/enet.h>
 
+#include "../core/command_queue.hpp"
 #include "../core/core.hpp"
-#include "../player/player.hpp"
+#include "../core/flight_recorder.hpp"
+#include "../core/packet_capture.hpp"
+#include "../utils/text_parse_view.hpp"
 
 namespace server {
 class Server final {
@@ -10,17 +13,29 @@ public:
     explicit Server(core::Core* core);
     ~Server();
 
-    void process();
+    void process(enet_uint32 timeout = 16);
 
     void on_connect(ENetPeer* peer);
-    void on_receive(ENetPeer* peer, ENetPacket* packet);
+    void on_receive(ENetPeer* peer, ENetPacket* packet, enet_uint8 channel);
     void on_disconnect(ENetPeer* peer);
 
-    [[nodiscard]] player::Player* get_player() const { return player_; }
+    [[nodiscard]] core::CommandQueue& get_command_queue() { return command_queue_; }
+    [[nodiscard]] ENetHost* get_host() const { return host_; }
+    // Null if flightRecorder.enabled is off.
+    [[nodiscard]] core::FlightRecorder* get_flight_recorder() const { return flight_recorder_.get(); }
 
 private:
+    // Connects the upstream for the game client's first message, which must be its login.
+    bool request_upstream(core::Session& session, const player::Player& player, const ENetPacket* packet);
+
     ENetHost* host_;
     core::Core* core_;
-    player::Player* player_;
+    core::CommandQueue command_queue_;
+    // Everything received from the game clients, if capture.enabled is on.
+    std::unique_ptr<core::PacketCapture> capture_;
+    // The last moments of traffic from the game clients, dumped when a session ends.
+    std::unique_ptr<core::FlightRecorder> flight_recorder_;
+    // Index of the text message being dispatched, reused so parsing stops allocating.
+    TextParseView message_view_;
 };
 }
@@ -0,0 +1,82 @@
+#pragma once
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "../core/packet_capture.hpp"
+
+namespace tools {
+struct CapturedPacket {
+    std::chrono::system_clock::time_point time;
+    core::PacketCapture::CaptureHeader header;
+    // May be shorter than original_size for flight recorder dumps.
+    std::vector<std::byte> data;
+    std::size_t original_size;
+};
+
+/**
+ * @brief Read the pcapng files written by core::PacketCapture and core::FlightRecorder.
+ *
+ * Blocks other than Enhanced Packet Blocks are skipped.
+ *
+ * @throw std::runtime_error If the file cannot be read or is not such a capture.
+ */
+[[nodiscard]] inline std::vector<CapturedPacket> read_capture(const std::filesystem::path& path)
+{
+    std::ifstream ifs{ path, std::ios::binary };
+    if (!ifs.good()) {
+        throw std::runtime_error{ "Failed to open " + path.string() };
+    }
+
+    const std::vector<char> file{ std::istreambuf_iterator{ ifs }, std::istreambuf_iterator<char>{} };
+
+    const auto read_u32{ [&file](const std::size_t offset) {
+        uint32_t value{};
+        std::memcpy(&value, file.data() + offset, sizeof(value));
+        return value;
+    } };
+
+    constexpr std::size_t header_size{ sizeof(core::PacketCapture::CaptureHeader) };
+
+    std::vector<CapturedPacket> packets{};
+    for (std::size_t offset{ 0 }; offset + 12 <= file.size();) {
+        const uint32_t type{ read_u32(offset) };
+        const uint32_t length{ read_u32(offset + 4) };
+        if (length < 12 || length % 4 != 0 || offset + length > file.size()) {
+            throw std::runtime_error{ "Truncated or corrupt block in " + path.string() };
+        }
+
+        if (offset == 0 && (type != 0x0A0D0D0A || read_u32(offset + 8) != 0x1A2B3C4D)) {
+            throw std::runtime_error{ path.string() + " is not a little-endian pcapng capture" };
+        }
+
+        // Enhanced packet block carrying at least our capture header.
+        if (type == 0x00000006 && length >= 32 + header_size) {
+            const uint64_t timestamp{ uint64_t{ read_u32(offset + 12) } << 32 | read_u32(offset + 16) };
+            const uint32_t captured_size{ read_u32(offset + 20) };
+            const uint32_t original_size{ read_u32(offset + 24) };
+
+            if (captured_size >= header_size && 28 + captured_size + 4 <= length) {
+                CapturedPacket packet{};
+                packet.time = std::chrono::system_clock::time_point{
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds{ timestamp })
+                };
+                std::memcpy(&packet.header, file.data() + offset + 28, header_size);
+
+                const auto* data{ reinterpret_cast<const std::byte*>(file.data() + offset + 28 + header_size) };
+                packet.data.assign(data, data + (captured_size - header_size));
+                packet.original_size = original_size - header_size;
+
+                packets.push_back(std::move(packet));
+            }
+        }
+
+        offset += length;
+    }
+
+    return packets;
+}
+}
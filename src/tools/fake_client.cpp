@@ -0,0 +1,345 @@
+/**
+ * gtproxy-fake-client: a crowd of scripted game clients, for load testing.
+ *
+ * Every bot logs in, follows OnSendToServer redirects like the game does,
+ * enters the game, joins a world and then streams PACKET_STATE at a fixed
+ * rate until the run ends. Pair it with gtproxy-game-server behind the proxy
+ * to put the relay under sustained synthetic load on one machine.
+ *
+ * Usage: gtproxy-fake-client [--host HOST] [--port PORT] [--clients N]
+ *                            [--state-rate N] [--world NAME] [--duration SECONDS]
+ */
+#include <iostream>
+#include <optional>
+#include <ranges>
+#include <string_view>
+#include <unordered_map>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "game_protocol.hpp"
+#include "peer_host.hpp"
+#include "../utils/text_parse.hpp"
+
+namespace {
+struct Options {
+    std::string host{ "127.0.0.1" };
+    enet_uint16 port{ 16999 };
+    std::size_t clients{ 1 };
+    double state_rate{ 20.0 };
+    std::string world{ "START" };
+    std::chrono::seconds duration{ 0 };
+};
+
+std::optional<Options> parse_options(const int argc, char** argv)
+{
+    Options options{};
+    for (int i{ 1 }; i < argc; i++) {
+        const std::string_view arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+
+        if (arg == "--host" && has_value) {
+            options.host = argv[++i];
+        }
+        else if (arg == "--port" && has_value) {
+            options.port = static_cast<enet_uint16>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--clients" && has_value) {
+            options.clients = std::max<std::size_t>(std::stoul(argv[++i]), 1);
+        }
+        else if (arg == "--state-rate" && has_value) {
+            options.state_rate = std::stod(argv[++i]);
+        }
+        else if (arg == "--world" && has_value) {
+            options.world = argv[++i];
+        }
+        else if (arg == "--duration" && has_value) {
+            options.duration = std::chrono::seconds{ std::stoul(argv[++i]) };
+        }
+        else {
+            return std::nullopt;
+        }
+    }
+
+    return options;
+}
+
+struct Bot {
+    enum class Stage {
+        Connecting,
+        LoggingIn,
+        Redirecting,
+        InGame,
+        InWorld
+    };
+
+    std::size_t index;
+    Stage stage{ Stage::Connecting };
+    int32_t net_id{ -1 };
+    tools::RateTimer states;
+
+    // From the last OnSendToServer.
+    std::string redirect_host;
+    enet_uint16 redirect_port{ 0 };
+    std::string token;
+    std::string user;
+    std::string uuid_token;
+};
+
+class FakeClients {
+public:
+    explicit FakeClients(const Options& options)
+        : options_{ options }
+        , host_{ tools::PeerHost::Role::GameClient, 0, options.clients }
+    {
+
+    }
+
+    [[nodiscard]] bool is_open() const { return host_.is_open(); }
+
+    void run()
+    {
+        for (std::size_t i{ 0 }; i < options_.clients; i++) {
+            connect(Bot{ .index = i, .states = tools::RateTimer{ options_.state_rate } }, options_.host, options_.port);
+        }
+
+        const auto started{ tools::Clock::now() };
+        auto next_report{ started + report_interval };
+        while (options_.duration == std::chrono::seconds::zero() || tools::Clock::now() - started < options_.duration) {
+            host_.service(1, [this](const ENetEvent& ev) { on_event(ev); });
+
+            const auto now{ tools::Clock::now() };
+            stream(now);
+
+            if (now >= next_report) {
+                report();
+                next_report = now + report_interval;
+            }
+        }
+
+        for (ENetPeer* peer : bots_ | std::views::keys) {
+            enet_peer_disconnect_now(peer, 0);
+        }
+
+        enet_host_flush(host_.get_host());
+        report();
+    }
+
+private:
+    static constexpr auto report_interval{ std::chrono::seconds{ 5 } };
+
+    void connect(Bot bot, const std::string& host, const enet_uint16 port)
+    {
+        bot.stage = Bot::Stage::Connecting;
+        if (ENetPeer* peer{ host_.connect(host, port) }) {
+            bots_.emplace(peer, std::move(bot));
+        }
+        else {
+            spdlog::error("Bot #{} failed to connect to {}:{}", bot.index, host, port);
+        }
+    }
+
+    void on_event(const ENetEvent& ev)
+    {
+        const auto it{ bots_.find(ev.peer) };
+        if (it == bots_.end()) {
+            return;
+        }
+
+        Bot& bot{ it->second };
+        if (ev.type == ENET_EVENT_TYPE_CONNECT) {
+            bot.stage = Bot::Stage::LoggingIn;
+        }
+        else if (ev.type == ENET_EVENT_TYPE_DISCONNECT) {
+            Bot gone{ std::move(bot) };
+            bots_.erase(it);
+
+            if (gone.stage == Bot::Stage::Redirecting) {
+                const std::string host{ gone.redirect_host };
+                const enet_uint16 port{ gone.redirect_port };
+                connect(std::move(gone), host, port);
+            }
+            else {
+                spdlog::warn("Bot #{} was disconnected", gone.index);
+            }
+        }
+        else if (ev.type == ENET_EVENT_TYPE_RECEIVE) {
+            received_++;
+            received_bytes_ += ev.packet->dataLength;
+
+            if (const auto received{ tools::parse({ reinterpret_cast<const std::byte*>(ev.packet->data), ev.packet->dataLength }) }) {
+                on_receive(ev.peer, bot, *received);
+            }
+        }
+    }
+
+    void on_receive(ENetPeer* peer, Bot& bot, const tools::Received& received)
+    {
+        if (received.type == packet::NET_MESSAGE_SERVER_HELLO) {
+            std::string login{ fmt::format(
+                "requestedName|bot{}\nf|1\nprotocol|{}\ngame_version|{}\nplatformID|0,1,1\n",
+                bot.index,
+                protocol,
+                game_version
+            ) };
+
+            if (!bot.token.empty()) {
+                login += fmt::format("token|{}\nuser|{}\nUUIDToken|{}\n", bot.token, bot.user, bot.uuid_token);
+            }
+
+            send(peer, tools::make_text(packet::NET_MESSAGE_GENERIC_TEXT, login));
+            return;
+        }
+
+        if (received.type != packet::NET_MESSAGE_GAME_PACKET) {
+            return;
+        }
+
+        if (received.header.type == packet::PACKET_SEND_MAP_DATA) {
+            maps_++;
+            return;
+        }
+
+        if (received.header.type != packet::PACKET_CALL_FUNCTION) {
+            return;
+        }
+
+        packet::Variant args{};
+        if (!args.deserialize(received.ext_data)) {
+            return;
+        }
+
+        const std::string function{ args.get(0) };
+        if (function == "OnSendToServer") {
+            const std::vector tokens{ TextParse::tokenize(args.get(4)) };
+            if (tokens.empty()) {
+                return;
+            }
+
+            bot.redirect_host = tokens.front();
+            bot.redirect_port = static_cast<enet_uint16>(args.get<int32_t>(1));
+            bot.token = std::to_string(args.get<int32_t>(2));
+            bot.user = std::to_string(args.get<int32_t>(3));
+            bot.uuid_token = tokens.back();
+            bot.stage = Bot::Stage::Redirecting;
+
+            enet_peer_disconnect(peer, 0);
+            redirects_++;
+        }
+        else if (function == "OnSuperMainStartAcceptLogonHrdxs47254722215a") {
+            bot.stage = Bot::Stage::InGame;
+            send(peer, tools::make_text(packet::NET_MESSAGE_GAME_MESSAGE, "action|enter_game\n"));
+        }
+        else if (function == "OnRequestWorldSelectMenu") {
+            send(peer, tools::make_text(
+                packet::NET_MESSAGE_GAME_MESSAGE,
+                fmt::format("action|join_request\nname|{}\ninvitedWorld|0\n", options_.world)
+            ));
+        }
+        else if (function == "OnSpawn") {
+            const TextParse spawn{ args.get(1) };
+            if (spawn.get("type") == "local") {
+                bot.net_id = std::stoi(spawn.get("netID"));
+                bot.stage = Bot::Stage::InWorld;
+            }
+        }
+    }
+
+    void stream(const tools::Clock::time_point now)
+    {
+        for (auto& [peer, bot] : bots_) {
+            if (bot.stage != Bot::Stage::InWorld) {
+                continue;
+            }
+
+            for (int i{ bot.states.due(now) }; i > 0; i--) {
+                packet::GameUpdatePacket state{};
+                state.type = packet::PACKET_STATE;
+                state.net_id = bot.net_id;
+                state.vec_x = static_cast<float>(sent_ % 3200);
+                state.vec_y = 1024.0f;
+                state.int_x = -1;
+                state.int_y = -1;
+                send(peer, tools::make_game_packet(state), 0);
+            }
+        }
+    }
+
+    void send(ENetPeer* peer, const std::vector<std::byte>& data, const enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE)
+    {
+        if (tools::PeerHost::send(peer, data, 0, flags)) {
+            sent_++;
+        }
+    }
+
+    void report()
+    {
+        std::size_t in_world{ 0 };
+        for (const Bot& bot : bots_ | std::views::values) {
+            in_world += bot.stage == Bot::Stage::InWorld;
+        }
+
+        constexpr double seconds{ std::chrono::duration<double>{ report_interval }.count() };
+        spdlog::info(
+            "{} bots ({} in a world), {} redirects, {} maps, sent {:.0f} packets/s, received {:.0f} packets/s ({:.2f} MB/s)",
+            bots_.size(),
+            in_world,
+            redirects_,
+            maps_,
+            static_cast<double>(sent_ - reported_sent_) / seconds,
+            static_cast<double>(received_ - reported_received_) / seconds,
+            static_cast<double>(received_bytes_ - reported_received_bytes_) / seconds / (1024.0 * 1024.0)
+        );
+
+        reported_sent_ = sent_;
+        reported_received_ = received_;
+        reported_received_bytes_ = received_bytes_;
+    }
+
+    static constexpr int protocol{ 312 };
+    static constexpr std::string_view game_version{ "5.11" };
+
+    Options options_;
+    tools::PeerHost host_;
+    std::unordered_map<ENetPeer*, Bot> bots_;
+
+    uint64_t redirects_{ 0 };
+    uint64_t maps_{ 0 };
+    uint64_t sent_{ 0 };
+    uint64_t received_{ 0 };
+    uint64_t received_bytes_{ 0 };
+    uint64_t reported_sent_{ 0 };
+    uint64_t reported_received_{ 0 };
+    uint64_t reported_received_bytes_{ 0 };
+};
+}
+
+int main(const int argc, char** argv)
+{
+    const auto options{ parse_options(argc, argv) };
+    if (!options) {
+        std::cerr << "Usage: gtproxy-fake-client [--host HOST] [--port PORT] [--clients N] "
+                     "[--state-rate N] [--world NAME] [--duration SECONDS]\n";
+        return 2;
+    }
+
+    if (enet_initialize() != 0) {
+        spdlog::error("Failed to initialize ENet");
+        return 1;
+    }
+
+    {
+        FakeClients clients{ *options };
+        if (!clients.is_open()) {
+            spdlog::error("Failed to create the client host");
+            enet_deinitialize();
+            return 1;
+        }
+
+        spdlog::info("Connecting {} bots to {}:{}", options->clients, options->host, options->port);
+        clients.run();
+    }
+
+    enet_deinitialize();
+    return 0;
+}
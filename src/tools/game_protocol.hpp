@@ -0,0 +1,130 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../packet/packet_types.hpp"
+#include "../packet/packet_variant.hpp"
+
+namespace tools {
+using Clock = std::chrono::steady_clock;
+
+// A text message; the receiver strips the trailing NUL.
+[[nodiscard]] inline std::vector<std::byte> make_text(const packet::NetMessageType type, const std::string_view text)
+{
+    std::vector<std::byte> data(sizeof(type) + text.size() + 1);
+    std::memcpy(data.data(), &type, sizeof(type));
+    std::memcpy(data.data() + sizeof(type), text.data(), text.size());
+    return data;
+}
+
+[[nodiscard]] inline std::vector<std::byte> make_game_packet(
+    packet::GameUpdatePacket header,
+    const std::span<const std::byte> ext_data = {}
+)
+{
+    if (!ext_data.empty()) {
+        header.flags.extended = 1;
+        header.data_size = static_cast<uint32_t>(ext_data.size());
+    }
+
+    constexpr packet::NetMessageType type{ packet::NET_MESSAGE_GAME_PACKET };
+
+    std::vector<std::byte> data(sizeof(type) + sizeof(header) + ext_data.size());
+    std::memcpy(data.data(), &type, sizeof(type));
+    std::memcpy(data.data() + sizeof(type), &header, sizeof(header));
+    std::ranges::copy(ext_data, data.begin() + sizeof(type) + sizeof(header));
+    return data;
+}
+
+[[nodiscard]] inline std::vector<std::byte> make_call_function(const packet::Variant& args, const int32_t net_id = -1)
+{
+    packet::GameUpdatePacket header{};
+    header.type = packet::PACKET_CALL_FUNCTION;
+    header.net_id = static_cast<uint32_t>(net_id);
+
+    return make_game_packet(header, args.serialize());
+}
+
+struct Received {
+    packet::NetMessageType type;
+    // Text messages only.
+    std::string text;
+    // Game packets only.
+    packet::GameUpdatePacket header;
+    std::span<const std::byte> ext_data;
+};
+
+// Views into data, which must outlive the result.
+[[nodiscard]] inline std::optional<Received> parse(const std::span<const std::byte> data)
+{
+    Received received{};
+    if (data.size() < sizeof(received.type)) {
+        return std::nullopt;
+    }
+
+    std::memcpy(&received.type, data.data(), sizeof(received.type));
+    const std::span payload{ data.subspan(sizeof(received.type)) };
+
+    if (received.type == packet::NET_MESSAGE_GENERIC_TEXT || received.type == packet::NET_MESSAGE_GAME_MESSAGE) {
+        const auto* text{ reinterpret_cast<const char*>(payload.data()) };
+        received.text.assign(text, std::find(text, text + payload.size(), '\0'));
+    }
+    else if (received.type == packet::NET_MESSAGE_GAME_PACKET) {
+        if (payload.size() < sizeof(received.header)) {
+            return std::nullopt;
+        }
+
+        std::memcpy(&received.header, payload.data(), sizeof(received.header));
+        if (received.header.flags.extended) {
+            received.ext_data = payload.subspan(
+                sizeof(received.header),
+                std::min<std::size_t>(received.header.data_size, payload.size() - sizeof(received.header))
+            );
+        }
+    }
+
+    return received;
+}
+
+/**
+ * @brief Paces sends at a fixed rate.
+ *
+ * A late caller gets the sends it missed, but never more than a second's worth,
+ * so a stall does not turn into a burst.
+ */
+class RateTimer {
+public:
+    explicit RateTimer(const double per_second)
+        : interval_{ per_second > 0
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{ 1.0 / per_second })
+            : Clock::duration::zero() }
+        , burst_{ std::max(static_cast<int>(per_second), 1) }
+        , next_{ Clock::now() }
+    {
+
+    }
+
+    // The number of sends due now.
+    [[nodiscard]] int due(const Clock::time_point now)
+    {
+        if (interval_ == Clock::duration::zero() || now < next_) {
+            return 0;
+        }
+
+        const int count{ static_cast<int>(std::min<Clock::rep>((now - next_) / interval_ + 1, burst_)) };
+        next_ = std::max(next_ + interval_ * count, now - interval_ * burst_);
+        return count;
+    }
+
+private:
+    Clock::duration interval_;
+    int burst_;
+    Clock::time_point next_;
+};
+}
@@ -0,0 +1,345 @@
+/**
+ * gtproxy-game-server: a local stand-in for the game servers, for load testing.
+ *
+ * Speaks just enough of the protocol for the proxy and the fake client: the
+ * hello and login handshake, an OnSendToServer redirect to a "sub-server"
+ * (itself, told apart by the login token), a world join answered with a large
+ * PACKET_SEND_MAP_DATA, then a steady stream of PACKET_STATE and
+ * PACKET_CALL_FUNCTION to every player in a world at configurable rates.
+ *
+ * Point the proxy at it with client.upstreamAddress and client.upstreamPort.
+ * Runs until --duration is up (forever if 0, the default) or it is
+ * interrupted.
+ *
+ * Usage: gtproxy-game-server [--port PORT] [--peers N] [--map-size KIB]
+ *                            [--state-rate N] [--call-rate N] [--no-redirect]
+ *                            [--duration SECONDS]
+ */
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <optional>
+#include <ranges>
+#include <string_view>
+#include <unordered_map>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "game_protocol.hpp"
+#include "peer_host.hpp"
+#include "../utils/text_parse.hpp"
+
+namespace {
+struct Options {
+    enet_uint16 port{ 17091 };
+    std::size_t peers{ 1024 };
+    std::size_t map_size{ 256 * 1024 };
+    double state_rate{ 20.0 };
+    double call_rate{ 2.0 };
+    bool redirect{ true };
+    std::chrono::seconds duration{ 0 };
+};
+
+// Set by SIGINT, so players are disconnected and ENet is shut down cleanly.
+std::atomic<bool> interrupted{ false };
+
+std::optional<Options> parse_options(const int argc, char** argv)
+{
+    Options options{};
+    for (int i{ 1 }; i < argc; i++) {
+        const std::string_view arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+
+        if (arg == "--port" && has_value) {
+            options.port = static_cast<enet_uint16>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--peers" && has_value) {
+            options.peers = std::stoul(argv[++i]);
+        }
+        else if (arg == "--map-size" && has_value) {
+            options.map_size = std::stoul(argv[++i]) * 1024;
+        }
+        else if (arg == "--state-rate" && has_value) {
+            options.state_rate = std::stod(argv[++i]);
+        }
+        else if (arg == "--call-rate" && has_value) {
+            options.call_rate = std::stod(argv[++i]);
+        }
+        else if (arg == "--no-redirect") {
+            options.redirect = false;
+        }
+        else if (arg == "--duration" && has_value) {
+            options.duration = std::chrono::seconds{ std::stoul(argv[++i]) };
+        }
+        else {
+            return std::nullopt;
+        }
+    }
+
+    return options;
+}
+
+struct Player {
+    enum class Stage {
+        Connected,
+        Redirected,
+        LoggedIn,
+        InWorld
+    };
+
+    Stage stage{ Stage::Connected };
+    int32_t net_id;
+    tools::RateTimer states;
+    tools::RateTimer calls;
+};
+
+class GameServer {
+public:
+    explicit GameServer(const Options& options)
+        : options_{ options }
+        , host_{ tools::PeerHost::Role::GameServer, options.port, options.peers }
+        , map_data_(options.map_size)
+    {
+        // Compresses about as well as a real world does.
+        for (std::size_t i{ 0 }; i < map_data_.size(); i++) {
+            map_data_[i] = static_cast<std::byte>(i % 64 < 48 ? 0 : i * 31 % 251);
+        }
+    }
+
+    [[nodiscard]] bool is_open() const { return host_.is_open(); }
+
+    void run()
+    {
+        const auto started{ tools::Clock::now() };
+        auto next_report{ started + report_interval };
+        while (!interrupted.load(std::memory_order_relaxed)
+            && (options_.duration == std::chrono::seconds::zero() || tools::Clock::now() - started < options_.duration)) {
+            host_.service(1, [this](const ENetEvent& ev) { on_event(ev); });
+
+            const auto now{ tools::Clock::now() };
+            stream(now);
+
+            if (now >= next_report) {
+                report();
+                next_report = now + report_interval;
+            }
+        }
+
+        for (ENetPeer* peer : players_ | std::views::keys) {
+            enet_peer_disconnect_now(peer, 0);
+        }
+
+        enet_host_flush(host_.get_host());
+        report();
+    }
+
+private:
+    static constexpr auto report_interval{ std::chrono::seconds{ 5 } };
+
+    void on_event(const ENetEvent& ev)
+    {
+        if (ev.type == ENET_EVENT_TYPE_CONNECT) {
+            players_.emplace(ev.peer, Player{
+                .net_id = next_net_id_++,
+                .states = tools::RateTimer{ options_.state_rate },
+                .calls = tools::RateTimer{ options_.call_rate }
+            });
+
+            send(ev.peer, tools::make_text(packet::NET_MESSAGE_SERVER_HELLO, {}));
+        }
+        else if (ev.type == ENET_EVENT_TYPE_DISCONNECT) {
+            players_.erase(ev.peer);
+        }
+        else if (ev.type == ENET_EVENT_TYPE_RECEIVE) {
+            received_++;
+
+            const auto it{ players_.find(ev.peer) };
+            const auto received{ tools::parse({ reinterpret_cast<const std::byte*>(ev.packet->data), ev.packet->dataLength }) };
+            if (it != players_.end() && received) {
+                on_receive(ev.peer, it->second, *received);
+            }
+        }
+    }
+
+    void on_receive(ENetPeer* peer, Player& player, const tools::Received& received)
+    {
+        if (received.type == packet::NET_MESSAGE_GENERIC_TEXT) {
+            const TextParse text_parse{ received.text };
+            if (text_parse.get("requestedName").empty() && text_parse.get("tankIDName").empty()) {
+                return;
+            }
+
+            // A login with our token comes back from the redirect.
+            if (options_.redirect && text_parse.get("token") != std::to_string(token_)) {
+                send(peer, tools::make_call_function(packet::Variant{
+                    std::string{ "OnSendToServer" },
+                    static_cast<int32_t>(options_.port),
+                    token_,
+                    player.net_id,
+                    std::string{ "127.0.0.1|-1|stand-in" },
+                    int32_t{ 1 }
+                }));
+
+                player.stage = Player::Stage::Redirected;
+                enet_peer_disconnect_later(peer, 0);
+                return;
+            }
+
+            player.stage = Player::Stage::LoggedIn;
+            send(peer, tools::make_call_function(packet::Variant{
+                std::string{ "OnSuperMainStartAcceptLogonHrdxs47254722215a" },
+                uint32_t{ 0 },
+                std::string{ "127.0.0.1" },
+                std::string{ "cache/" }
+            }));
+            send(peer, tools::make_call_function(packet::Variant{
+                std::string{ "OnConsoleMessage" },
+                std::string{ "Welcome to the stand-in server!" }
+            }));
+        }
+        else if (received.type == packet::NET_MESSAGE_GAME_MESSAGE) {
+            const TextParse text_parse{ received.text };
+            const std::string action{ text_parse.get("action") };
+
+            if (action == "enter_game") {
+                send(peer, tools::make_call_function(packet::Variant{
+                    std::string{ "OnRequestWorldSelectMenu" },
+                    std::string{ "default|START\n" }
+                }));
+            }
+            else if (action == "join_request" && player.stage == Player::Stage::LoggedIn) {
+                packet::GameUpdatePacket map{};
+                map.type = packet::PACKET_SEND_MAP_DATA;
+                map.net_id = -1;
+                send(peer, tools::make_game_packet(map, map_data_));
+
+                send(peer, tools::make_call_function(
+                    packet::Variant{
+                        std::string{ "OnSpawn" },
+                        fmt::format("spawn|avatar\nnetID|{}\nname|{}\ntype|local\n", player.net_id, text_parse.get("name"))
+                    },
+                    player.net_id
+                ));
+
+                player.stage = Player::Stage::InWorld;
+            }
+        }
+    }
+
+    void stream(const tools::Clock::time_point now)
+    {
+        for (auto& [peer, player] : players_) {
+            if (player.stage != Player::Stage::InWorld) {
+                continue;
+            }
+
+            for (int i{ player.states.due(now) }; i > 0; i--) {
+                packet::GameUpdatePacket state{};
+                state.type = packet::PACKET_STATE;
+                state.net_id = player.net_id;
+                state.vec_x = static_cast<float>(sent_ % 3200);
+                state.vec_y = 1024.0f;
+                state.int_x = -1;
+                state.int_y = -1;
+                send(peer, tools::make_game_packet(state), 0);
+            }
+
+            for (int i{ player.calls.due(now) }; i > 0; i--) {
+                send(peer, tools::make_call_function(
+                    packet::Variant{
+                        std::string{ "OnTalkBubble" },
+                        player.net_id,
+                        fmt::format("stand-in message #{}", sent_),
+                        int32_t{ 0 }
+                    },
+                    player.net_id
+                ));
+            }
+        }
+    }
+
+    void send(ENetPeer* peer, const std::vector<std::byte>& data, const enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE)
+    {
+        if (tools::PeerHost::send(peer, data, 0, flags)) {
+            sent_++;
+            sent_bytes_ += data.size();
+        }
+    }
+
+    void report()
+    {
+        std::size_t in_world{ 0 };
+        for (const auto& player : players_ | std::views::values) {
+            in_world += player.stage == Player::Stage::InWorld;
+        }
+
+        constexpr double seconds{ std::chrono::duration<double>{ report_interval }.count() };
+        spdlog::info(
+            "{} players ({} in a world), sent {:.0f} packets/s ({:.2f} MB/s), received {:.0f} packets/s",
+            players_.size(),
+            in_world,
+            static_cast<double>(sent_ - reported_sent_) / seconds,
+            static_cast<double>(sent_bytes_ - reported_sent_bytes_) / seconds / (1024.0 * 1024.0),
+            static_cast<double>(received_ - reported_received_) / seconds
+        );
+
+        reported_sent_ = sent_;
+        reported_sent_bytes_ = sent_bytes_;
+        reported_received_ = received_;
+    }
+
+    Options options_;
+    tools::PeerHost host_;
+    std::vector<std::byte> map_data_;
+
+    std::unordered_map<ENetPeer*, Player> players_;
+    int32_t next_net_id_{ 1 };
+    // The same for every login; only tells redirected logins apart.
+    int32_t token_{ 0x5354414e };
+
+    uint64_t sent_{ 0 };
+    uint64_t sent_bytes_{ 0 };
+    uint64_t received_{ 0 };
+    uint64_t reported_sent_{ 0 };
+    uint64_t reported_sent_bytes_{ 0 };
+    uint64_t reported_received_{ 0 };
+};
+}
+
+int main(const int argc, char** argv)
+{
+    const auto options{ parse_options(argc, argv) };
+    if (!options) {
+        std::cerr << "Usage: gtproxy-game-server [--port PORT] [--peers N] [--map-size KIB] "
+                     "[--state-rate N] [--call-rate N] [--no-redirect] [--duration SECONDS]\n";
+        return 2;
+    }
+
+    if (enet_initialize() != 0) {
+        spdlog::error("Failed to initialize ENet");
+        return 1;
+    }
+
+    {
+        GameServer server{ *options };
+        if (!server.is_open()) {
+            spdlog::error("Failed to listen on port {}", options->port);
+            enet_deinitialize();
+            return 1;
+        }
+
+        spdlog::info(
+            "Stand-in game server listening on port {} ({} KiB map data, {} states/s and {} calls/s per player)",
+            options->port,
+            options->map_size / 1024,
+            options->state_rate,
+            options->call_rate
+        );
+
+        std::signal(SIGINT, [](int) { interrupted.store(true, std::memory_order_relaxed); });
+        server.run();
+    }
+
+    enet_deinitialize();
+    return 0;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+#include <enet/enet.h>
+
+namespace tools {
+/**
+ * @brief An ENet host speaking the patched protocol of one side of the game.
+ *
+ * A GameClient host connects out like the game does, a GameServer host listens
+ * like the real servers do; both match the compression and checksum the proxy
+ * uses on its own hosts. ENet must be initialized first.
+ */
+class PeerHost {
+public:
+    enum class Role {
+        GameClient,
+        GameServer
+    };
+
+    PeerHost(const Role role, const enet_uint16 port, const std::size_t peer_count)
+    {
+        ENetAddress address{};
+        address.host = ENET_HOST_ANY;
+        address.port = port;
+
+        host_ = enet_host_create(role == Role::GameServer ? &address : nullptr, peer_count, 2, 0, 0);
+        if (!host_) {
+            return;
+        }
+
+        enet_host_compress_with_range_coder(host_);
+        host_->checksum = enet_crc32;
+
+        if (role == Role::GameServer) {
+            host_->usingNewPacketForServer = 1;
+        }
+        else {
+            host_->usingNewPacket = 1;
+        }
+    }
+
+    ~PeerHost()
+    {
+        if (host_) {
+            enet_host_destroy(host_);
+        }
+    }
+
+    PeerHost(const PeerHost&) = delete;
+    PeerHost& operator=(const PeerHost&) = delete;
+
+    [[nodiscard]] bool is_open() const { return host_ != nullptr; }
+    [[nodiscard]] ENetHost* get_host() const { return host_; }
+
+    ENetPeer* connect(const std::string& host, const enet_uint16 port) const
+    {
+        ENetAddress address{};
+        enet_address_set_host(&address, host.c_str());
+        address.port = port;
+
+        return enet_host_connect(host_, &address, 2, 0);
+    }
+
+    /**
+     * @brief Service the host once, handing every event to on_event.
+     *
+     * Received packets are destroyed after on_event returns.
+     *
+     * @return int The number of events handled.
+     */
+    template <typename OnEvent>
+    int service(const enet_uint32 timeout, OnEvent&& on_event) const
+    {
+        int count{ 0 };
+
+        ENetEvent ev{};
+        for (int ret{ enet_host_service(host_, &ev, timeout) }; ret > 0; ret = enet_host_check_events(host_, &ev)) {
+            on_event(ev);
+            if (ev.type == ENET_EVENT_TYPE_RECEIVE) {
+                enet_packet_destroy(ev.packet);
+            }
+
+            count++;
+        }
+
+        return count;
+    }
+
+    static bool send(
+        ENetPeer* peer,
+        const std::span<const std::byte> data,
+        const enet_uint8 channel = 0,
+        const enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE
+    )
+    {
+        ENetPacket* packet{ enet_packet_create(data.data(), data.size(), flags) };
+        if (!packet) {
+            return false;
+        }
+
+        if (enet_peer_send(peer, channel < peer->channelCount ? channel : 0, packet) != 0) {
+            enet_packet_destroy(packet);
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+    ENetHost* host_;
+};
+}
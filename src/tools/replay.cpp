@@ -0,0 +1,474 @@
+/**
+ * gtproxy-replay: feed a recorded session through the proxy and measure it.
+ *
+ * Loads pcapng files written by the capture subsystem or the flight recorder
+ * and replays one session through a real Core (server and client hosts,
+ * dispatchers, parser and sub-server switch extensions) sitting between an
+ * in-process fake game client and stand-in game server. Packets are sent in
+ * recorded order as fast as the proxy takes them, with a bounded number in
+ * flight per direction, so the same capture gives comparable numbers on
+ * every commit.
+ *
+ * The report goes to stdout as JSON: throughput, end-to-end latency per
+ * direction, time spent in Core::dispatch, heap and ENet pool allocations per
+ * packet (counted process-wide, so the stand-in hosts are included), and how
+ * often the server called each function. config.json in the working directory
+ * is used as is, except for the port and the logging, capture and flight
+ * recorder toggles.
+ *
+ * Usage: gtproxy-replay [--session ID] [--port PORT] [--window N] CAPTURE...
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "capture_reader.hpp"
+#include "peer_host.hpp"
+#include "../core/core.hpp"
+#include "../core/enet_pool.hpp"
+#include "../extension/parser/parser_impl.hpp"
+#include "../extension/sub_server_switch/sub_server_switch_impl.hpp"
+
+namespace {
+std::atomic<uint64_t> allocations{ 0 };
+}
+
+// Count every heap allocation in the process, the proxy's included.
+void* operator new(const std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr{ std::malloc(size != 0 ? size : 1) }) {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::optional<uint32_t> session;
+    enet_uint16 port{ 17091 };
+    std::size_t window{ 256 };
+    std::vector<std::filesystem::path> captures;
+};
+
+std::optional<Options> parse_options(const int argc, char** argv)
+{
+    Options options{};
+    for (int i{ 1 }; i < argc; i++) {
+        const std::string_view arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+
+        if (arg == "--session" && has_value) {
+            options.session = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--port" && has_value) {
+            options.port = static_cast<enet_uint16>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--window" && has_value) {
+            options.window = std::max<std::size_t>(std::stoul(argv[++i]), 1);
+        }
+        else if (arg.starts_with("--")) {
+            return std::nullopt;
+        }
+        else {
+            options.captures.emplace_back(arg);
+        }
+    }
+
+    if (options.captures.empty()) {
+        return std::nullopt;
+    }
+
+    return options;
+}
+
+std::size_t hash_payload(const std::span<const std::byte> data)
+{
+    return std::hash<std::string_view>{}({ reinterpret_cast<const char*>(data.data()), data.size() });
+}
+
+/**
+ * @brief Packets sent into the proxy in one direction, waiting to come out.
+ *
+ * Arrivals are matched by payload against the oldest outstanding packets;
+ * anything skipped over was canceled by the proxy, and an arrival matching
+ * nothing was rewritten or synthesized by it.
+ */
+class InFlight {
+public:
+    explicit InFlight(const std::size_t capacity)
+    {
+        sent_.reserve(capacity);
+        latencies_.reserve(capacity);
+    }
+
+    void sent(const std::size_t hash) { sent_.push_back({ hash, Clock::now() }); }
+
+    void arrived(const std::size_t hash)
+    {
+        const std::size_t end{ std::min(sent_.size(), head_ + lookahead) };
+        for (std::size_t i{ head_ }; i < end; i++) {
+            if (sent_[i].hash != hash) {
+                continue;
+            }
+
+            latencies_.push_back(Clock::now() - sent_[i].time);
+            not_forwarded_ += i - head_;
+            head_ = i + 1;
+            return;
+        }
+
+        rewritten_++;
+    }
+
+    // Give up on the oldest outstanding packet.
+    void drop_oldest()
+    {
+        if (head_ < sent_.size()) {
+            head_++;
+            not_forwarded_++;
+        }
+    }
+
+    [[nodiscard]] std::size_t outstanding() const { return sent_.size() - head_; }
+    [[nodiscard]] std::vector<Clock::duration>& get_latencies() { return latencies_; }
+    [[nodiscard]] std::size_t get_not_forwarded() const { return not_forwarded_ + outstanding(); }
+    [[nodiscard]] std::size_t get_rewritten() const { return rewritten_; }
+
+private:
+    static constexpr std::size_t lookahead{ 64 };
+
+    struct Sent {
+        std::size_t hash;
+        Clock::time_point time;
+    };
+
+    std::vector<Sent> sent_;
+    std::size_t head_{ 0 };
+    std::vector<Clock::duration> latencies_;
+    std::size_t not_forwarded_{ 0 };
+    std::size_t rewritten_{ 0 };
+};
+
+// Time from the first typed packet listener (or first message listener) to the
+// last generic one, per direction. Each direction is only touched by the thread
+// servicing its host.
+struct DispatchTimer {
+    explicit DispatchTimer(const std::size_t capacity)
+    {
+        for (auto& direction : samples) {
+            direction.reserve(capacity);
+        }
+    }
+
+    // Each direction is dispatched on its own host thread.
+    void record(const core::EventFrom from, const Clock::duration elapsed)
+    {
+        std::vector<Clock::duration>& direction{ samples[from == core::EventFrom::FromClient ? 0 : 1] };
+        if (direction.size() < direction.capacity()) {
+            direction.push_back(elapsed);
+        }
+    }
+
+    std::array<std::vector<Clock::duration>, 2> samples;
+};
+
+nlohmann::json summarize(std::vector<Clock::duration>& samples)
+{
+    if (samples.empty()) {
+        return { { "count", 0 } };
+    }
+
+    std::ranges::sort(samples);
+
+    const auto micros{ [](const Clock::duration duration) {
+        return std::chrono::duration<double, std::micro>{ duration }.count();
+    } };
+
+    return {
+        { "count", samples.size() },
+        { "p50_us", micros(samples[samples.size() / 2]) },
+        { "p99_us", micros(samples[samples.size() * 99 / 100]) },
+        { "max_us", micros(samples.back()) }
+    };
+}
+
+uint64_t pool_misses()
+{
+    uint64_t misses{ 0 };
+    for (const auto& stats : core::EnetPool::get_stats()) {
+        misses += stats.misses;
+    }
+
+    return misses + core::EnetPool::get_oversized_count();
+}
+
+std::vector<tools::CapturedPacket> load_session(const Options& options)
+{
+    std::vector<tools::CapturedPacket> packets{};
+    for (const auto& path : options.captures) {
+        std::vector file{ tools::read_capture(path) };
+        std::ranges::move(file, std::back_inserter(packets));
+    }
+
+    std::optional<uint32_t> session{ options.session };
+    if (!session) {
+        const auto it{ std::ranges::find_if(packets, [](const auto& packet) { return packet.header.session != 0; }) };
+        if (it != packets.end()) {
+            session = it->header.session;
+            spdlog::info("Replaying session #{}", *session);
+        }
+    }
+
+    std::erase_if(packets, [&](const auto& packet) { return packet.header.session != session; });
+    // The proxy greets the game client itself and swallows the server's hello.
+    std::erase_if(packets, [](const auto& packet) {
+        uint32_t type{};
+        if (packet.header.from != static_cast<uint8_t>(core::EventFrom::FromServer) || packet.data.size() < sizeof(type)) {
+            return false;
+        }
+
+        std::memcpy(&type, packet.data.data(), sizeof(type));
+        return type == packet::NET_MESSAGE_SERVER_HELLO;
+    });
+    std::ranges::stable_sort(packets, {}, &tools::CapturedPacket::time);
+
+    const auto truncated{ std::ranges::count_if(packets, [](const auto& packet) {
+        return packet.data.size() < packet.original_size;
+    }) };
+    if (truncated != 0) {
+        spdlog::warn("{} packets were recorded truncated and are replayed as such", truncated);
+    }
+
+    return packets;
+}
+}
+
+int main(const int argc, char** argv)
+{
+    spdlog::set_default_logger(spdlog::stderr_color_mt("gtproxy-replay"));
+
+    const auto options{ parse_options(argc, argv) };
+    if (!options) {
+        std::cerr << "Usage: gtproxy-replay [--session ID] [--port PORT] [--window N] CAPTURE...\n";
+        return 2;
+    }
+
+    try {
+        const std::vector packets{ load_session(*options) };
+        if (packets.empty()) {
+            spdlog::error("No packets to replay");
+            return 1;
+        }
+
+        const enet_uint16 upstream_port{ static_cast<enet_uint16>(options->port + 1) };
+
+        core::Config config{};
+        config.set("enet.port", static_cast<unsigned int>(options->port));
+        config.set("log.printMessage", false);
+        config.set("log.printGameUpdatePacket", false);
+        config.set("log.printVariant", false);
+        config.set("capture.enabled", false);
+        config.set("flightRecorder.enabled", false);
+        // The proxy's upstream leg connects to the stand-in server.
+        config.set("client.upstreamAddress", std::string{ "127.0.0.1" });
+        config.set("client.upstreamPort", static_cast<unsigned int>(upstream_port));
+
+        const auto redirects{ std::make_shared<core::RedirectTable>() };
+        core::Core core{ config, redirects, 0, 1 };
+        core.add_extension(new extension::parser::ParserExtension{ &core });
+        core.add_extension(new extension::sub_server_switch::SubServerSwitchExtension{ &core });
+
+        // Timed inside Core::dispatch, so no extra listeners change what is measured.
+        DispatchTimer dispatch_timer{ packets.size() };
+        core.set_dispatch_timer([&](const core::EventFrom from, const Clock::duration elapsed) {
+            dispatch_timer.record(from, elapsed);
+        });
+
+        const tools::PeerHost game_server{ tools::PeerHost::Role::GameServer, upstream_port, 1 };
+        const tools::PeerHost game_client{ tools::PeerHost::Role::GameClient, 0, 1 };
+        if (!game_server.is_open() || !game_client.is_open()) {
+            spdlog::error("Failed to create the stand-in hosts");
+            return 1;
+        }
+
+        std::thread core_thread{ [&core] { core.run(); } };
+        const auto stop_core{ [&] {
+            core.stop();
+            core_thread.join();
+        } };
+
+        ENetPeer* client_peer{ game_client.connect("127.0.0.1", options->port) };
+        ENetPeer* server_peer{};
+        bool client_connected{ false };
+        bool disconnected{ false };
+
+        InFlight to_server{ packets.size() };
+        InFlight to_client{ packets.size() };
+
+        const auto on_client_event{ [&](const ENetEvent& ev) {
+            if (ev.type == ENET_EVENT_TYPE_CONNECT) {
+                client_connected = true;
+            }
+            else if (ev.type == ENET_EVENT_TYPE_RECEIVE) {
+                to_client.arrived(hash_payload({ reinterpret_cast<const std::byte*>(ev.packet->data), ev.packet->dataLength }));
+            }
+            else if (ev.type == ENET_EVENT_TYPE_DISCONNECT) {
+                disconnected = true;
+            }
+        } };
+        const auto on_server_event{ [&](const ENetEvent& ev) {
+            if (ev.type == ENET_EVENT_TYPE_CONNECT) {
+                server_peer = ev.peer;
+            }
+            else if (ev.type == ENET_EVENT_TYPE_RECEIVE) {
+                to_server.arrived(hash_payload({ reinterpret_cast<const std::byte*>(ev.packet->data), ev.packet->dataLength }));
+            }
+            else if (ev.type == ENET_EVENT_TYPE_DISCONNECT) {
+                disconnected = true;
+            }
+        } };
+
+        // The upstream leg follows once the recorded login went through.
+        const auto connect_deadline{ Clock::now() + std::chrono::seconds{ 5 } };
+        while (!client_connected && Clock::now() < connect_deadline) {
+            game_client.service(1, on_client_event);
+            game_server.service(1, on_server_event);
+        }
+
+        if (!client_connected) {
+            spdlog::error("The proxy did not accept the game client");
+            stop_core();
+            return 1;
+        }
+
+        constexpr auto stall_timeout{ std::chrono::milliseconds{ 250 } };
+
+        const uint64_t pool_misses_before{ pool_misses() };
+        const uint64_t allocations_before{ allocations.load(std::memory_order_relaxed) };
+        const auto started{ Clock::now() };
+        auto last_progress{ started };
+
+        std::size_t next{ 0 };
+        std::size_t bytes{ 0 };
+        while (!disconnected) {
+            // Send in recorded order, as long as the packet's direction has room.
+            while (next < packets.size()) {
+                const tools::CapturedPacket& packet{ packets[next] };
+                const bool from_client{ packet.header.from == static_cast<uint8_t>(core::EventFrom::FromClient) };
+
+                InFlight& in_flight{ from_client ? to_server : to_client };
+                if (in_flight.outstanding() >= options->window || (!from_client && !server_peer)) {
+                    break;
+                }
+
+                tools::PeerHost::send(
+                    from_client ? client_peer : server_peer,
+                    packet.data,
+                    packet.header.channel,
+                    packet.header.flags & packet::forwarded_flags
+                );
+                in_flight.sent(hash_payload(packet.data));
+
+                bytes += packet.data.size();
+                next++;
+            }
+
+            const int events{ game_client.service(0, on_client_event) + game_server.service(0, on_server_event) };
+            const auto now{ Clock::now() };
+            if (events > 0) {
+                last_progress = now;
+            }
+
+            if (to_server.outstanding() == 0 && to_client.outstanding() == 0 && next == packets.size()) {
+                break;
+            }
+
+            if (now - last_progress > stall_timeout) {
+                if (next == packets.size()) {
+                    break;
+                }
+
+                // The proxy swallowed something; stop waiting for it.
+                to_server.drop_oldest();
+                to_client.drop_oldest();
+                last_progress = now;
+            }
+        }
+
+        const auto elapsed{ std::chrono::duration<double>{ last_progress - started }.count() };
+        const uint64_t allocated{ allocations.load(std::memory_order_relaxed) - allocations_before };
+        const uint64_t pool_missed{ pool_misses() - pool_misses_before };
+
+        stop_core();
+
+        if (disconnected) {
+            spdlog::warn("A leg disconnected after {} of {} packets", next, packets.size());
+        }
+
+        const auto per_packet{ [&](const uint64_t count) {
+            return next != 0 ? static_cast<double>(count) / static_cast<double>(next) : 0.0;
+        } };
+
+        nlohmann::json call_functions = nlohmann::json::object();
+        for (const auto& stats : core.query_extension<IParserExtension>()->get_call_function_stats()) {
+            call_functions[stats.function_name] = stats.count;
+        }
+
+        const nlohmann::json report{
+            { "packets", next },
+            { "bytes", bytes },
+            { "seconds", elapsed },
+            { "packets_per_second", elapsed > 0 ? static_cast<double>(next) / elapsed : 0.0 },
+            { "megabytes_per_second", elapsed > 0 ? static_cast<double>(bytes) / elapsed / (1024.0 * 1024.0) : 0.0 },
+            { "not_forwarded", to_server.get_not_forwarded() + to_client.get_not_forwarded() },
+            { "rewritten", to_server.get_rewritten() + to_client.get_rewritten() },
+            { "latency", {
+                { "client_to_server", summarize(to_server.get_latencies()) },
+                { "server_to_client", summarize(to_client.get_latencies()) }
+            } },
+            { "dispatch", {
+                { "from_client", summarize(dispatch_timer.samples[0]) },
+                { "from_server", summarize(dispatch_timer.samples[1]) }
+            } },
+            { "allocations_per_packet", per_packet(allocated) },
+            // The pool is process-wide, so this counts the stand-in hosts' allocations too.
+            { "enet_pool", {
+                { "misses_per_packet", per_packet(pool_missed) },
+                { "includes_stand_in_hosts", true }
+            } },
+            { "call_functions", call_functions }
+        };
+
+        std::cout << report.dump(4) << std::endl;
+    }
+    catch (const std::exception& ex) {
+        spdlog::error("Replay failed: {}", ex.what());
+        return 1;
+    }
+
+    return 0;
+}
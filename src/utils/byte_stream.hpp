@@ -1,6 +1,8 @@
 #pragma once
-#include <vector>
+#include <cstring>
+#include <span>
 #include <string>
+#include <vector>
 
 template <typename LengthType = std::uint16_t>
 class ByteStream {
@@ -126,9 +128,123 @@ public:
     void skip(const std::size_t size) { read_offset_ += size; }
     [[nodiscard]] std::size_t get_read_offset() const { return read_offset_; }
     [[nodiscard]] std::size_t get_size() const { return data_.size(); }
-    [[nodiscard]] std::vector<std::byte> get_data() const { return data_; }
+    [[nodiscard]] const std::vector<std::byte>& get_data() const { return data_; }
+    [[nodiscard]] std::span<const std::byte> get_span() const { return data_; }
 
 private:
     std::vector<std::byte> data_;
     std::size_t read_offset_;
 };
+
+/**
+ * @brief Read-only ByteStream over memory it does not own.
+ *
+ * Parses straight out of a receive buffer such as ENetPacket::data, so the
+ * caller must keep that buffer alive for as long as the view (and any span
+ * handed out by it) is in use.
+ */
+template <typename LengthType = std::uint16_t>
+class ByteStreamView {
+public:
+    ByteStreamView()
+        : read_offset_{ 0 }
+    {
+
+    }
+
+    explicit ByteStreamView(const std::span<const std::byte> data)
+        : data_{ data }
+        , read_offset_{ 0 }
+    {
+
+    }
+
+    ByteStreamView(const std::byte* data, const std::size_t length)
+        : data_{ data, length }
+        , read_offset_{ 0 }
+    {
+
+    }
+
+    bool read_data(void* ptr, const std::size_t size)
+    {
+        if (get_remaining() < size) {
+            return false;
+        }
+
+        std::memcpy(ptr, data_.data() + read_offset_, size);
+        read_offset_ += size;
+        return true;
+    }
+
+    // Hand out the next bytes without copying them.
+    bool read_span(std::span<const std::byte>& span, const std::size_t size)
+    {
+        if (get_remaining() < size) {
+            return false;
+        }
+
+        span = data_.subspan(read_offset_, size);
+        read_offset_ += size;
+        return true;
+    }
+
+    bool read_vector(std::vector<std::byte>& vec, LengthType length = 0)
+    {
+        if (length == 0) {
+            if (!read<LengthType>(length)) {
+                return false;
+            }
+        }
+
+        std::span<const std::byte> span{};
+        if (!read_span(span, static_cast<std::size_t>(length))) {
+            return false;
+        }
+
+        vec.assign(span.begin(), span.end());
+        return true;
+    }
+
+    template <typename T>
+    bool read(T& value)
+    {
+        return read_data(&value, sizeof(T));
+    }
+
+    bool read(std::string& str, LengthType length = 0)
+    {
+        if (length == 0) {
+            if (!read<LengthType>(length)) {
+                return false;
+            }
+        }
+
+        std::span<const std::byte> span{};
+        if (!read_span(span, static_cast<std::size_t>(length))) {
+            return false;
+        }
+
+        str.assign(reinterpret_cast<const char*>(span.data()), span.size());
+        return true;
+    }
+
+    void reset_ptr() { read_offset_ = 0; }
+
+    template <typename T>
+    ByteStreamView& operator>>(T& value)
+    {
+        read(value);
+        return *this;
+    }
+
+    void skip(const std::size_t size) { read_offset_ += size; }
+    [[nodiscard]] std::size_t get_read_offset() const { return read_offset_; }
+    [[nodiscard]] std::size_t get_remaining() const { return read_offset_ < data_.size() ? data_.size() - read_offset_ : 0; }
+    [[nodiscard]] std::size_t get_size() const { return data_.size(); }
+    [[nodiscard]] std::span<const std::byte> get_data() const { return data_; }
+
+private:
+    std::span<const std::byte> data_;
+    std::size_t read_offset_;
+};
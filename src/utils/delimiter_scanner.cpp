@@ -0,0 +1,209 @@
+#include <bit>
+
+#include "delimiter_scanner.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GTPROXY_SCANNER_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GTPROXY_TARGET_SSE2
+#define GTPROXY_TARGET_AVX2
+#else
+#define GTPROXY_TARGET_SSE2 __attribute__((target("sse2")))
+#define GTPROXY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+using ScanFunction = void (*)(const char*, std::size_t, char, char, std::vector<uint32_t>&);
+
+void scan_scalar(
+    const char* data,
+    const std::size_t size,
+    const char first,
+    const char second,
+    std::vector<uint32_t>& positions,
+    const std::size_t begin = 0
+)
+{
+    for (std::size_t i{ begin }; i < size; i++) {
+        if (data[i] == first || data[i] == second) {
+            positions.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void scan_scalar_entry(
+    const char* data,
+    const std::size_t size,
+    const char first,
+    const char second,
+    std::vector<uint32_t>& positions
+)
+{
+    scan_scalar(data, size, first, second, positions);
+}
+
+#ifdef GTPROXY_SCANNER_X86
+// Bit n of mask set means a delimiter at offset + n.
+void push_mask(uint32_t mask, const std::size_t offset, std::vector<uint32_t>& positions)
+{
+    while (mask != 0) {
+        positions.push_back(static_cast<uint32_t>(offset + std::countr_zero(mask)));
+        mask &= mask - 1;
+    }
+}
+
+GTPROXY_TARGET_SSE2 void scan_sse2(
+    const char* data,
+    const std::size_t size,
+    const char first,
+    const char second,
+    std::vector<uint32_t>& positions
+)
+{
+    const __m128i first_v{ _mm_set1_epi8(first) };
+    const __m128i second_v{ _mm_set1_epi8(second) };
+
+    std::size_t i{ 0 };
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)) };
+        const __m128i matches{ _mm_or_si128(_mm_cmpeq_epi8(chunk, first_v), _mm_cmpeq_epi8(chunk, second_v)) };
+        push_mask(static_cast<uint32_t>(_mm_movemask_epi8(matches)), i, positions);
+    }
+
+    scan_scalar(data, size, first, second, positions, i);
+}
+
+GTPROXY_TARGET_AVX2 void scan_avx2(
+    const char* data,
+    const std::size_t size,
+    const char first,
+    const char second,
+    std::vector<uint32_t>& positions
+)
+{
+    const __m256i first_v{ _mm256_set1_epi8(first) };
+    const __m256i second_v{ _mm256_set1_epi8(second) };
+
+    std::size_t i{ 0 };
+    for (; i + 32 <= size; i += 32) {
+        const __m256i chunk{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)) };
+        const __m256i matches{ _mm256_or_si256(_mm256_cmpeq_epi8(chunk, first_v), _mm256_cmpeq_epi8(chunk, second_v)) };
+        push_mask(static_cast<uint32_t>(_mm256_movemask_epi8(matches)), i, positions);
+    }
+
+    scan_scalar(data, size, first, second, positions, i);
+}
+
+bool cpu_has_avx2()
+{
+#if defined(_MSC_VER)
+    int info[4]{};
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    // The OS must save the YMM registers too.
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // Needed when this runs during static initialization, before libgcc's own
+    // constructor has filled in the CPU model; harmless otherwise.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+ScanFunction get_function(const DelimiterScanner::Isa isa)
+{
+    switch (isa) {
+#ifdef GTPROXY_SCANNER_X86
+    case DelimiterScanner::Isa::Avx2:
+        return scan_avx2;
+    case DelimiterScanner::Isa::Sse2:
+        return scan_sse2;
+#endif
+    default:
+        return scan_scalar_entry;
+    }
+}
+
+DelimiterScanner::Isa select_isa()
+{
+#ifdef GTPROXY_SCANNER_X86
+    if (cpu_has_avx2()) {
+        return DelimiterScanner::Isa::Avx2;
+    }
+
+    if (DelimiterScanner::is_supported(DelimiterScanner::Isa::Sse2)) {
+        return DelimiterScanner::Isa::Sse2;
+    }
+#endif
+
+    return DelimiterScanner::Isa::Scalar;
+}
+
+// Chosen on first use rather than during static initialization, which may already scan.
+ScanFunction get_selected_function()
+{
+    static const ScanFunction function{ get_function(DelimiterScanner::get_isa()) };
+    return function;
+}
+}
+
+void DelimiterScanner::scan(
+    const std::string_view text,
+    const char first,
+    const char second,
+    std::vector<uint32_t>& positions
+)
+{
+    get_selected_function()(text.data(), text.size(), first, second, positions);
+}
+
+void DelimiterScanner::scan(
+    const Isa isa,
+    const std::string_view text,
+    const char first,
+    const char second,
+    std::vector<uint32_t>& positions
+)
+{
+    get_function(isa)(text.data(), text.size(), first, second, positions);
+}
+
+bool DelimiterScanner::is_supported(const Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return true;
+#ifdef GTPROXY_SCANNER_X86
+    case Isa::Sse2:
+        // Always there on x86-64; 32-bit builds need to have been told.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        return true;
+#else
+        return false;
+#endif
+    case Isa::Avx2:
+        return cpu_has_avx2();
+#endif
+    default:
+        return false;
+    }
+}
+
+DelimiterScanner::Isa DelimiterScanner::get_isa()
+{
+    static const Isa isa{ select_isa() };
+    return isa;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Finds every occurrence of two delimiter characters in one pass.
+ *
+ * Compares 32 (AVX2) or 16 (SSE2) bytes at a time and turns the matches into
+ * positions with a bitmask, instead of testing one character after another.
+ * The widest instruction set the CPU supports is picked once at startup;
+ * other CPUs use the scalar loop.
+ */
+class DelimiterScanner {
+public:
+    enum class Isa {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    /**
+     * @brief Append the position of every first or second character in text to positions.
+     *
+     * Pass the same character twice to look for just one.
+     */
+    static void scan(std::string_view text, char first, char second, std::vector<uint32_t>& positions);
+    // The same with a given instruction set, which must be supported; for benchmarks.
+    static void scan(Isa isa, std::string_view text, char first, char second, std::vector<uint32_t>& positions);
+
+    [[nodiscard]] static bool is_supported(Isa isa);
+    // The instruction set scan() uses.
+    [[nodiscard]] static Isa get_isa();
+};
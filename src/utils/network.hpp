@@ -1,7 +1,9 @@
 #pragma once
 #include <algorithm>
+#include <charconv>
 #include <vector>
 
+#include "delimiter_scanner.hpp"
 #include "text_parse.hpp"
 
 namespace network {
@@ -12,19 +14,27 @@ enum class HostType {
 
 inline bool is_valid_ip_address(const std::string& address)
 {
-    std::vector parts{ TextParse::tokenize(address, ".") };
-    if (parts.size() != 4) {
-        return false;
-    }
+    thread_local std::vector<uint32_t> dots{};
+    dots.clear();
+    DelimiterScanner::scan(address, '.', '.', dots);
+    dots.push_back(static_cast<uint32_t>(address.size()));
 
-    return std::ranges::all_of(parts, [](const std::string& part){
-        try {
-            return std::stoi(part) >= 0 && std::stoi(part) <= 255;
-        }
-        catch (const std::exception&) {
-            return false;
+    // Four numbers from 0 to 255; empty parts are skipped, as TextParse::tokenize does.
+    int parts{ 0 };
+    std::size_t part_start{ 0 };
+    for (const uint32_t dot : dots) {
+        if (dot != part_start) {
+            int value{ -1 };
+            const auto [end, ec]{ std::from_chars(address.data() + part_start, address.data() + dot, value) };
+            if (ec != std::errc{} || end != address.data() + dot || value < 0 || value > 255 || ++parts > 4) {
+                return false;
+            }
         }
-    });
+
+        part_start = dot + 1;
+    }
+
+    return parts == 4;
 }
 
 constexpr HostType classify_host(const std::string& host)
@@ -1,38 +1,79 @@
 #pragma once
+#include <algorithm>
 #include <ranges>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
-#include <unordered_map>
 
+#include "delimiter_scanner.hpp"
+#include "hash.hpp"
+#include "text_parse_view.hpp"
+
+/**
+ * @brief An editable "key|value|value\n..." text.
+ *
+ * Owns copies of its keys and values, kept in the order they were parsed or
+ * added so get_raw() reproduces the original layout. Parsing goes through
+ * TextParseView; code that only reads a message should use the view directly
+ * and skip the copies.
+ */
 class TextParse {
 public:
+    struct Field {
+        std::string key;
+        std::vector<std::string> values;
+        uint32_t hash;
+    };
+
     TextParse() = default;
 
     explicit TextParse(const std::string& str, const std::string& delimiter = "|")
+        : TextParse{ TextParseView{ str, delimiter } }
     {
-        for (const auto& line : tokenize(str, "\n")) {
-            std::vector tokens{ tokenize(line, delimiter) };
 
-            if (tokens.empty()) {
-                continue;
-            }
+    }
 
-            if (tokens.size() == 1) {
+    explicit TextParse(const TextParseView& view)
+    {
+        data_.reserve(view.size());
+        for (std::size_t i{ 0 }; i < view.size(); i++) {
+            const std::string_view key{ view.get_key(i) };
+            if (find({ key, view.get_key_hash(i) }) != data_.end()) {
                 continue;
             }
 
-            std::string key{ tokens.front() };
-
-            tokens.erase(tokens.begin());
-            tokens.shrink_to_fit();
+            std::vector<std::string> values{};
+            values.reserve(view.get_value_count(i));
+            for (std::size_t j{ 0 }; j < view.get_value_count(i); j++) {
+                values.emplace_back(view.get_value(i, j));
+            }
 
-            data_.emplace(key, tokens);
+            data_.push_back({ std::string{ key }, std::move(values), view.get_key_hash(i) });
         }
     }
 
     static std::vector<std::string> tokenize(const std::string& string, const std::string& delimiter = "|")
     {
         std::vector<std::string> tokens{};
+        if (delimiter.size() == 1) {
+            thread_local std::vector<uint32_t> positions{};
+            positions.clear();
+            DelimiterScanner::scan(string, delimiter.front(), delimiter.front(), positions);
+            positions.push_back(static_cast<uint32_t>(string.size()));
+
+            std::size_t token_start{ 0 };
+            for (const uint32_t position : positions) {
+                if (position != token_start) {
+                    tokens.emplace_back(string, token_start, position - token_start);
+                }
+
+                token_start = position + 1;
+            }
+
+            return tokens;
+        }
+
         for (auto&& token : string | std::views::split(delimiter)) {
             if (token.empty()) {
                 continue;
@@ -44,22 +85,22 @@ public:
         return tokens;
     }
 
-    [[nodiscard]] std::string get(const std::string& key, const int index = 0) const
+    [[nodiscard]] std::string get(const TextKey key, const int index = 0) const
     {
-        const auto it{ data_.find(key) };
+        const auto it{ find(key) };
         if (it == data_.end()) {
             return {};
         }
 
-        if (index < 0 || index >= it->second.size()) {
+        if (index < 0 || index >= it->values.size()) {
             return {};
         }
 
-        return it->second[index];
+        return it->values[index];
     }
 
     template <typename T>
-    [[nodiscard]] T get(const std::string& key, const int index = 0) const
+    [[nodiscard]] T get(const TextKey key, const int index = 0) const
     {
         if constexpr (std::is_integral_v<T>) {
             if constexpr (std::is_unsigned_v<T>) {
@@ -84,21 +125,24 @@ public:
 
     void add(const std::string& key, const std::vector<std::string>& value)
     {
-        data_.emplace(key, value);
+        if (!contains(key)) {
+            data_.push_back({ key, value, hash::fnv1a_32(key) });
+        }
     }
 
     void set(const std::string& key, const std::vector<std::string>& value)
     {
-        if (!data_.contains(key)) {
+        const auto it{ find(key) };
+        if (it == data_.end()) {
             return;
         }
 
-        data_[key] = value;
+        it->values = value;
     }
 
     void remove(const std::string& key)
     {
-        const auto it{ data_.find(key) };
+        const auto it{ find(key) };
         if (it == data_.end()) {
             return;
         }
@@ -110,12 +154,12 @@ public:
     {
         std::string raw_data{};
         for (auto it = data_.cbegin(); it != data_.cend(); ++it) {
-            raw_data += prepend_text + it->first;
-            for (const auto& token : it->second) {
+            raw_data += prepend_text + it->key;
+            for (const auto& token : it->values) {
                 raw_data += delimiter + token;
             }
 
-            if (std::next(it) != data_.cend() && !std::next(it)->first.empty()) {
+            if (std::next(it) != data_.cend() && !std::next(it)->key.empty()) {
                 raw_data += '\n';
             }
         }
@@ -127,8 +171,8 @@ public:
     {
         std::vector<std::string> key_values{};
         for (auto it = data_.cbegin(); it != data_.cend(); ++it) {
-            std::string key_value{ it->first };
-            for (const auto& token : it->second) {
+            std::string key_value{ it->key };
+            for (const auto& token : it->values) {
                 key_value += delimiter + token;
             }
 
@@ -138,10 +182,20 @@ public:
         return key_values;
     }
 
-    [[nodiscard]] std::unordered_map<std::string, std::vector<std::string>>& get_data() { return data_; }
+    [[nodiscard]] const std::vector<Field>& get_data() const { return data_; }
     [[nodiscard]] bool empty() const { return data_.empty(); }
-    [[nodiscard]] bool contains(const char *key) const { return data_.find(key) != data_.end(); }
+    [[nodiscard]] bool contains(const TextKey key) const { return find(key) != data_.end(); }
 
 private:
-    std::unordered_map<std::string, std::vector<std::string>> data_;
+    [[nodiscard]] std::vector<Field>::iterator find(const TextKey key)
+    {
+        return std::ranges::find_if(data_, [&key](const Field& field) { return key.matches(field.hash, field.key); });
+    }
+
+    [[nodiscard]] std::vector<Field>::const_iterator find(const TextKey key) const
+    {
+        return std::ranges::find_if(data_, [&key](const Field& field) { return key.matches(field.hash, field.key); });
+    }
+
+    std::vector<Field> data_;
 };
@@ -0,0 +1,219 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "delimiter_scanner.hpp"
+#include "hash.hpp"
+
+/**
+ * @brief A TextParse key together with its FNV-1a hash.
+ *
+ * String literals are hashed at compile time, other strings when the key is
+ * made. Lookups compare hashes and only check the name on a match, so a hash
+ * collision cannot return the wrong field.
+ */
+struct TextKey {
+    template <std::size_t N>
+    consteval TextKey(const char (&str)[N])
+        : name{ str, N - 1 }
+        , hash{ hash::fnv1a_32(name) }
+    {
+
+    }
+
+    constexpr TextKey(const std::string_view str)
+        : name{ str }
+        , hash{ hash::fnv1a_32(str) }
+    {
+
+    }
+
+    constexpr TextKey(const std::string& str)
+        : TextKey{ std::string_view{ str } }
+    {
+
+    }
+
+    // A name whose hash is already known, e.g. from TextParseView::get_key_hash().
+    constexpr TextKey(const std::string_view str, const uint32_t key_hash)
+        : name{ str }
+        , hash{ key_hash }
+    {
+
+    }
+
+    [[nodiscard]] constexpr bool matches(const uint32_t other_hash, const std::string_view other) const
+    {
+        return hash == other_hash && name == other;
+    }
+
+    std::string_view name;
+    uint32_t hash;
+};
+
+/**
+ * @brief Index of a "key|value|value\n..." text over a buffer it does not own.
+ *
+ * Parsing records where every key and value starts and ends in one flat vector,
+ * in the order they appear, without copying any text. Reparsing into the same
+ * view reuses its storage, so a long-lived view stops allocating once it has
+ * seen the largest message. The buffer must outlive the view.
+ *
+ * Follows TextParse's rules: empty tokens are skipped, lines without a value
+ * are ignored, and the first of several equal keys wins. Keys are hashed while
+ * parsing, so a lookup is an integer compare per field.
+ */
+class TextParseView {
+public:
+    TextParseView() = default;
+
+    explicit TextParseView(const std::string_view text, const std::string_view delimiter = "|")
+    {
+        parse(text, delimiter);
+    }
+
+    void parse(const std::string_view text, const std::string_view delimiter = "|")
+    {
+        text_ = text;
+        tokens_.clear();
+        fields_.clear();
+
+        if (delimiter.size() == 1 && delimiter.front() != '\n') {
+            parse_scanned(delimiter.front());
+        }
+        else {
+            parse_generic(delimiter);
+        }
+    }
+
+    // The first field with this key.
+    [[nodiscard]] std::optional<std::size_t> find(const TextKey key) const
+    {
+        for (std::size_t i{ 0 }; i < fields_.size(); i++) {
+            if (key.matches(fields_[i].hash, get_key(i))) {
+                return i;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    [[nodiscard]] std::string_view get(const TextKey key, const int index = 0) const
+    {
+        const auto field{ find(key) };
+        if (!field || index < 0 || static_cast<std::size_t>(index) >= get_value_count(*field)) {
+            return {};
+        }
+
+        return get_value(*field, static_cast<std::size_t>(index));
+    }
+
+    [[nodiscard]] bool contains(const TextKey key) const { return find(key).has_value(); }
+
+    // Fields in the order they appear in the text.
+    [[nodiscard]] std::size_t size() const { return fields_.size(); }
+    [[nodiscard]] bool empty() const { return fields_.empty(); }
+    [[nodiscard]] std::string_view get_key(const std::size_t field) const { return token(fields_[field].first); }
+    [[nodiscard]] uint32_t get_key_hash(const std::size_t field) const { return fields_[field].hash; }
+    [[nodiscard]] std::size_t get_value_count(const std::size_t field) const { return fields_[field].count - 1; }
+
+    [[nodiscard]] std::string_view get_value(const std::size_t field, const std::size_t index) const
+    {
+        return token(fields_[field].first + 1 + static_cast<uint32_t>(index));
+    }
+
+    [[nodiscard]] std::string_view get_text() const { return text_; }
+
+private:
+    // Every line break and delimiter found in one vectorized pass.
+    void parse_scanned(const char delimiter)
+    {
+        positions_.clear();
+        DelimiterScanner::scan(text_, '\n', delimiter, positions_);
+        positions_.push_back(static_cast<uint32_t>(text_.size()));
+
+        auto first{ static_cast<uint32_t>(tokens_.size()) };
+        std::size_t token_start{ 0 };
+        for (const uint32_t position : positions_) {
+            if (position != token_start) {
+                tokens_.push_back({ static_cast<uint32_t>(token_start), static_cast<uint32_t>(position - token_start) });
+            }
+
+            if (position == text_.size() || text_[position] == '\n') {
+                end_line(first);
+                first = static_cast<uint32_t>(tokens_.size());
+            }
+
+            token_start = position + 1;
+        }
+    }
+
+    void parse_generic(const std::string_view delimiter)
+    {
+        for (std::size_t line_start{ 0 }; line_start < text_.size();) {
+            std::size_t line_end{ text_.find('\n', line_start) };
+            if (line_end == std::string_view::npos) {
+                line_end = text_.size();
+            }
+
+            const std::string_view line{ text_.substr(line_start, line_end - line_start) };
+            const auto first{ static_cast<uint32_t>(tokens_.size()) };
+            for (std::size_t token_start{ 0 }; token_start < line.size();) {
+                std::size_t token_end{ delimiter.empty() ? std::string_view::npos : line.find(delimiter, token_start) };
+                if (token_end == std::string_view::npos) {
+                    token_end = line.size();
+                }
+
+                if (token_end != token_start) {
+                    tokens_.push_back({
+                        static_cast<uint32_t>(line_start + token_start),
+                        static_cast<uint32_t>(token_end - token_start)
+                    });
+                }
+
+                token_start = token_end + delimiter.size();
+            }
+
+            end_line(first);
+            line_start = line_end + 1;
+        }
+    }
+
+    // Keep the tokens from first on as a field, unless the line has no value.
+    void end_line(const uint32_t first)
+    {
+        const auto count{ static_cast<uint32_t>(tokens_.size()) - first };
+        if (count < 2) {
+            tokens_.resize(first);
+        }
+        else {
+            fields_.push_back({ first, count, hash::fnv1a_32(token(first)) });
+        }
+    }
+
+    struct Token {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    // tokens_[first] is the key, the values follow it.
+    struct Field {
+        uint32_t first;
+        uint32_t count;
+        uint32_t hash;
+    };
+
+    [[nodiscard]] std::string_view token(const uint32_t index) const
+    {
+        return text_.substr(tokens_[index].offset, tokens_[index].size);
+    }
+
+    std::string_view text_;
+    std::vector<Token> tokens_;
+    std::vector<Field> fields_;
+    // Scratch space for parse_scanned().
+    std::vector<uint32_t> positions_;
+};